@@ -0,0 +1,53 @@
+#include "../corpus_loader.h"
+#include "../read_input_functions.h"
+#include "benchmark_data.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+//Сравнивает LoadCorpus с построчным чтением через getline и AddDocument.
+//Аргументы: [число документов] [число потоков токенизации]
+int main(int argc, char* argv[]) {
+    const int document_count = argc > 1 ? stoi(argv[1]) : 100'000;
+    const size_t tokenizer_count = argc > 2 ? stoul(argv[2]) : 2;
+
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 10'000, 10);
+    const string path = "corpus_loader_benchmark.txt"s;
+    {
+        ofstream out(path);
+        for (int i = 0; i < document_count; ++i) {
+            out << GenerateQuery(generator, dictionary, 70) << '\n';
+        }
+    }
+
+    {
+        SearchServer search_server(dictionary[0]);
+        const auto start = chrono::steady_clock::now();
+        ifstream in(path);
+        size_t bytes = 0;
+        int document_id = 0;
+        for (string line; getline(in, line);) {
+            bytes += line.size() + 1;
+            search_server.AddDocument(document_id++, line, DocumentStatus::ACTUAL, {});
+        }
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        cout << "getline + AddDocument: "s << document_id << " documents, "s
+             << bytes / elapsed.count() / (1 << 20) << " MB/s"s << endl;
+    }
+
+    {
+        SearchServer search_server(dictionary[0]);
+        CorpusLoadOptions options;
+        options.tokenizer_count = tokenizer_count;
+        const CorpusLoadStats stats = LoadCorpus(search_server, path, options);
+        cout << "LoadCorpus ("s << tokenizer_count << " tokenizers): "s << stats.documents << " documents, "s
+             << stats.bytes / stats.seconds / (1 << 20) << " MB/s"s << endl;
+    }
+
+    remove(path.c_str());
+}
@@ -0,0 +1,60 @@
+#include "../search_server.h"
+#include "benchmark_data.h"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+//Сравнивает выбранный планировщиком план (FindTopDocuments без политики) с накоплением
+//релевантности по словам для TF-IDF и BM25: печатает время и проверяет, что суммарная
+//релевантность не изменилась. По словам выполняется только par, поэтому сравнение идёт
+//с par, а не с прежним seq, и его результат зависит от числа ядер
+int main() {
+    cout << "threads = "s << thread::hardware_concurrency() << endl;
+    mt19937 generator;
+
+    const auto dictionary = GenerateDictionary(generator, 2000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 50'000, 50);
+
+    SearchServer search_server(dictionary[0]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+
+    const RelevanceScorer scorers[] = {TfIdfScorer{}, Bm25Scorer{}};
+    const char* scorer_names[] = {"tf-idf", "bm25"};
+    for (int query_word_count : {1, 3, 10}) {
+        const auto queries = GenerateQueries(generator, dictionary, 300, query_word_count, 0.1);
+        for (size_t scorer = 0; scorer < size(scorers); ++scorer) {
+            search_server.SetScorer(scorers[scorer]);
+
+            auto start = chrono::steady_clock::now();
+            double planned_relevance = 0;
+            for (const string& query : queries) {
+                for (const auto& document : search_server.FindTopDocuments(query)) {
+                    planned_relevance += document.relevance;
+                }
+            }
+            const chrono::duration<double> planned_elapsed = chrono::steady_clock::now() - start;
+
+            start = chrono::steady_clock::now();
+            double term_at_a_time_relevance = 0;
+            for (const string& query : queries) {
+                for (const auto& document : search_server.FindTopDocuments(execution::par, query)) {
+                    term_at_a_time_relevance += document.relevance;
+                }
+            }
+            const chrono::duration<double> term_at_a_time_elapsed = chrono::steady_clock::now() - start;
+
+            cout << scorer_names[scorer] << ", words = "s << query_word_count
+                 << ", planned = "s << planned_elapsed.count() * 1000 << " ms"s
+                 << ", term-at-a-time par = "s << term_at_a_time_elapsed.count() * 1000 << " ms"s
+                 << ", relevance "s
+                 << (abs(planned_relevance - term_at_a_time_relevance) < 1e-6 ? "matches"s : "DIFFERS"s)
+                 << endl;
+        }
+        cout << search_server.Explain(queries[0]);
+    }
+}
@@ -0,0 +1,75 @@
+#include "../search_server.h"
+#include "benchmark_data.h"
+
+#include <chrono>
+#include <iostream>
+#include <numeric>
+
+using namespace std;
+
+namespace {
+
+SearchServer BuildServer(const vector<string>& documents, const string& stop_words) {
+    SearchServer search_server(stop_words);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    return search_server;
+}
+
+double SumRelevance(const SearchServer& search_server, const vector<string>& queries) {
+    double total_relevance = 0;
+    for (const string& query : queries) {
+        for (const auto& document : search_server.FindTopDocuments(query)) {
+            total_relevance += document.relevance;
+        }
+    }
+    return total_relevance;
+}
+
+}  // namespace
+
+//Удаляет половину документов в случайном порядке циклом RemoveDocument и одним вызовом
+//RemoveDocuments (seq и par): печатает время и проверяет, что поиск после удаления одинаковый
+int main() {
+    mt19937 generator;
+
+    const auto dictionary = GenerateDictionary(generator, 2000, 10);
+    const auto queries = GenerateQueries(generator, dictionary, 100, 5, 0.1);
+
+    for (int document_count : {10'000, 100'000}) {
+        const auto documents = GenerateQueries(generator, dictionary, document_count, 30);
+        vector<int> removed_ids(document_count);
+        iota(removed_ids.begin(), removed_ids.end(), 0);
+        shuffle(removed_ids.begin(), removed_ids.end(), generator);
+        removed_ids.resize(document_count / 2);
+
+        SearchServer looped_server = BuildServer(documents, dictionary[0]);
+        auto start = chrono::steady_clock::now();
+        for (const int document_id : removed_ids) {
+            looped_server.RemoveDocument(document_id);
+        }
+        const chrono::duration<double> looped_elapsed = chrono::steady_clock::now() - start;
+        const double expected_relevance = SumRelevance(looped_server, queries);
+        cout << "documents = "s << document_count << ", removed = "s << removed_ids.size()
+             << ", RemoveDocument loop = "s << looped_elapsed.count() * 1000 << " ms"s << endl;
+
+        const auto measure_batch = [&](const string& name, auto policy) {
+            SearchServer batch_server = BuildServer(documents, dictionary[0]);
+            const auto start = chrono::steady_clock::now();
+            batch_server.RemoveDocuments(policy, removed_ids);
+            const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+            const IndexStatistics batch_statistics = batch_server.GetIndexStatistics();
+            const IndexStatistics looped_statistics = looped_server.GetIndexStatistics();
+            const bool is_same = batch_server.GetDocumentCount() == looped_server.GetDocumentCount()
+                && batch_statistics.posting_count == looped_statistics.posting_count
+                && batch_statistics.empty_posting_lists == looped_statistics.empty_posting_lists
+                && equal(batch_server.begin(), batch_server.end(), looped_server.begin(), looped_server.end())
+                && abs(SumRelevance(batch_server, queries) - expected_relevance) < 1e-6;
+            cout << "  RemoveDocuments "s << name << " = "s << elapsed.count() * 1000 << " ms"s
+                 << ", index "s << (is_same ? "matches"s : "DIFFERS"s) << endl;
+        };
+        measure_batch("seq"s, execution::seq);
+        measure_batch("par"s, execution::par);
+    }
+}
@@ -0,0 +1,50 @@
+#include "../sharded_search_server.h"
+#include "benchmark_data.h"
+
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+//Сравнивает ShardedSearchServer на 1..64 шардах с обычным SearchServer:
+//печатает время, запросы в секунду и проверяет, что суммарная релевантность не изменилась
+int main() {
+    mt19937 generator;
+
+    const auto dictionary = GenerateDictionary(generator, 1000, 10);
+    const auto documents = GenerateQueries(generator, dictionary, 10'000, 70);
+    const auto queries = GenerateQueries(generator, dictionary, 300, 10, 0.1);
+
+    SearchServer search_server(dictionary[0]);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    double expected_relevance = 0;
+    for (const string& query : queries) {
+        for (const auto& document : search_server.FindTopDocuments(query)) {
+            expected_relevance += document.relevance;
+        }
+    }
+
+    for (size_t shard_count = 1; shard_count <= 64; shard_count *= 2) {
+        ShardedSearchServer sharded_server(dictionary[0], shard_count);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            sharded_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+
+        const auto start = chrono::steady_clock::now();
+        double total_relevance = 0;
+        for (const string& query : queries) {
+            for (const auto& document : sharded_server.FindTopDocuments(query)) {
+                total_relevance += document.relevance;
+            }
+        }
+        const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+        cout << "shards = "s << shard_count
+             << ", time = "s << elapsed.count() * 1000 << " ms"s
+             << ", qps = "s << queries.size() / elapsed.count()
+             << ", relevance "s << (abs(total_relevance - expected_relevance) < 1e-6 ? "matches"s : "DIFFERS"s)
+             << endl;
+    }
+}
@@ -0,0 +1,97 @@
+#include "../search_server.h"
+#include "benchmark_data.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <malloc.h>
+#include <new>
+
+using namespace std;
+
+//Считает выделения памяти при добавлении документов и при поиске,
+//и объём кучи после построения индекса на 10k, 100k и 1M документов.
+//Аргумент: наибольшее число документов (по умолчанию 1'000'000).
+//Завершается с кодом 1, если выделений или байт на слово документа больше границ ниже.
+
+namespace {
+
+//около одного узла списка документов на слово и выделения на сам документ;
+//строка на каждое слово дала бы больше трёх
+const double MAX_ALLOCATIONS_PER_TOKEN = 2.5;
+//на 10k документов заметна доля словаря, дальше около 80 байт
+const double MAX_BYTES_PER_TOKEN = 128.0;
+
+size_t allocation_count = 0;
+long long live_bytes = 0;
+
+}  // namespace
+
+void* operator new(size_t size) {
+    void* memory = malloc(size == 0 ? 1 : size);
+    if (memory == nullptr) {
+        throw bad_alloc();
+    }
+    ++allocation_count;
+    live_bytes += malloc_usable_size(memory);
+    return memory;
+}
+
+void operator delete(void* memory) noexcept {
+    if (memory != nullptr) {
+        live_bytes -= malloc_usable_size(memory);
+        free(memory);
+    }
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    operator delete(memory);
+}
+
+int main(int argc, char* argv[]) {
+    const int max_document_count = argc > 1 ? stoi(argv[1]) : 1'000'000;
+
+    mt19937 generator;
+    const auto dictionary = GenerateDictionary(generator, 50'000, 10);
+    const auto queries = GenerateQueries(generator, dictionary, 1'000, 5, 0.1);
+
+    bool is_within_bounds = true;
+    for (int document_count = 10'000; document_count <= max_document_count; document_count *= 10) {
+        size_t add_allocations = 0;
+        size_t token_count = 0;
+        const long long heap_before = live_bytes;
+        {
+            SearchServer search_server(dictionary[0]);
+            for (int i = 0; i < document_count; ++i) {
+                const string document = GenerateQuery(generator, dictionary, 20);
+                token_count += 20;
+                const size_t allocations_before = allocation_count;
+                search_server.AddDocument(i, document, DocumentStatus::ACTUAL, {1, 2, 3});
+                add_allocations += allocation_count - allocations_before;
+            }
+            const long long index_bytes = live_bytes - heap_before;
+
+            const size_t allocations_before = allocation_count;
+            for (const string& query : queries) {
+                search_server.FindTopDocuments(query);
+            }
+            const size_t query_allocations = allocation_count - allocations_before;
+
+            const double allocations_per_token = add_allocations * 1.0 / token_count;
+            const double bytes_per_token = index_bytes * 1.0 / token_count;
+            cout << "documents = "s << document_count
+                 << ", allocations per token in AddDocument = "s << allocations_per_token
+                 << ", allocations per query = "s << query_allocations * 1.0 / queries.size()
+                 << ", index heap = "s << index_bytes / (1 << 20) << " MB"s
+                 << " ("s << bytes_per_token << " bytes per token)"s << endl;
+            if (allocations_per_token > MAX_ALLOCATIONS_PER_TOKEN) {
+                cout << "  FAIL: more than "s << MAX_ALLOCATIONS_PER_TOKEN << " allocations per token"s << endl;
+                is_within_bounds = false;
+            }
+            if (bytes_per_token > MAX_BYTES_PER_TOKEN) {
+                cout << "  FAIL: more than "s << MAX_BYTES_PER_TOKEN << " bytes per token"s << endl;
+                is_within_bounds = false;
+            }
+        }
+    }
+    return is_within_bounds ? 0 : 1;
+}
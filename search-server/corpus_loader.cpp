@@ -0,0 +1,236 @@
+#include "corpus_loader.h"
+#include "spsc_queue.h"
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <optional>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+//Файл целиком в памяти: через mmap, а если отобразить не получилось
+//(например, это канал) - чтением большими блоками
+class CorpusFile {
+public:
+    explicit CorpusFile(const string& path) {
+        fd_ = open(path.c_str(), O_RDONLY);
+        if (fd_ < 0) {
+            throw runtime_error("Can't open "s + path + ": "s + strerror(errno));
+        }
+        struct stat file_stat;
+        if (fstat(fd_, &file_stat) == 0 && S_ISREG(file_stat.st_mode) && file_stat.st_size > 0) {
+            void* mapped = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+            if (mapped != MAP_FAILED) {
+                madvise(mapped, file_stat.st_size, MADV_SEQUENTIAL);
+                mapped_size_ = file_stat.st_size;
+                data_ = {static_cast<const char*>(mapped), mapped_size_};
+                return;
+            }
+        }
+        const size_t block_size = 1 << 20;
+        while (true) {
+            const size_t old_size = buffer_.size();
+            buffer_.resize(old_size + block_size);
+            const ssize_t received = read(fd_, buffer_.data() + old_size, block_size);
+            buffer_.resize(old_size + max<ssize_t>(received, 0));
+            if (received == 0) {
+                break;
+            }
+            if (received < 0 && errno != EINTR) {
+                throw runtime_error("Can't read "s + path + ": "s + strerror(errno));
+            }
+        }
+        data_ = buffer_;
+    }
+
+    CorpusFile(const CorpusFile&) = delete;
+
+    CorpusFile& operator=(const CorpusFile&) = delete;
+
+    ~CorpusFile() {
+        if (mapped_size_ > 0) {
+            munmap(const_cast<char*>(data_.data()), mapped_size_);
+        }
+        close(fd_);
+    }
+
+    string_view GetData() const {
+        return data_;
+    }
+
+private:
+    int fd_ = -1;
+    size_t mapped_size_ = 0;
+    string buffer_;
+    string_view data_;
+};
+
+struct Record {
+    int document_id;
+    string_view text;
+};
+
+struct RecordBatch {
+    vector<Record> records;
+    bool is_last = false;
+};
+
+struct TokenizedBatch {
+    vector<Record> records;
+    vector<vector<string_view>> words;
+    //документ с недопустимым словом не попадает в индекс
+    vector<bool> is_valid;
+    bool is_last = false;
+};
+
+//Очереди и потоки конвейера. Деструктор закрывает очереди и дожидается потоков:
+//если индексатор выйдет по исключению, стадии не зависнут на полной или пустой очереди,
+//а joinable потоки не приведут к std::terminate
+struct Pipeline {
+    vector<unique_ptr<SpscQueue<RecordBatch>>> record_queues;
+    vector<unique_ptr<SpscQueue<TokenizedBatch>>> tokenized_queues;
+    vector<thread> threads;
+
+    Pipeline() = default;
+
+    Pipeline(const Pipeline&) = delete;
+
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    ~Pipeline() {
+        for (auto& queue : record_queues) {
+            queue->Close();
+        }
+        for (auto& queue : tokenized_queues) {
+            queue->Close();
+        }
+        for (thread& worker : threads) {
+            worker.join();
+        }
+    }
+};
+
+}  // namespace
+
+CorpusLoadStats LoadCorpus(SearchServer& search_server, const string& path,
+                           const CorpusLoadOptions& options) {
+    const auto start = chrono::steady_clock::now();
+    const CorpusFile file(path);
+    const string_view data = file.GetData();
+    const size_t tokenizer_count = max<size_t>(1, options.tokenizer_count);
+    const size_t batch_size = max<size_t>(1, options.batch_size);
+    const size_t queue_capacity = max<size_t>(1, options.queue_capacity);
+
+    Pipeline pipeline;
+    auto& record_queues = pipeline.record_queues;
+    auto& tokenized_queues = pipeline.tokenized_queues;
+    for (size_t i = 0; i < tokenizer_count; ++i) {
+        record_queues.push_back(make_unique<SpscQueue<RecordBatch>>(queue_capacity));
+        tokenized_queues.push_back(make_unique<SpscQueue<TokenizedBatch>>(queue_capacity));
+    }
+
+    //пачки раздаются токенизаторам по кругу и в том же порядке забираются индексатором,
+    //поэтому документы добавляются в порядке строк файла
+    pipeline.threads.emplace_back([&] {
+        size_t queue = 0;
+        RecordBatch batch;
+        batch.records.reserve(batch_size);
+        int document_id = options.first_document_id;
+        string_view unread = data;
+        while (!unread.empty()) {
+            const char* line_end = static_cast<const char*>(memchr(unread.data(), '\n', unread.size()));
+            const size_t line_size = line_end ? line_end - unread.data() : unread.size();
+            string_view line = unread.substr(0, line_size);
+            unread.remove_prefix(min(unread.size(), line_size + 1));
+            if (!line.empty() && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+            if (!line.empty()) {
+                batch.records.push_back({document_id, line});
+            }
+            ++document_id;
+            if (batch.records.size() == batch_size) {
+                if (!record_queues[queue]->Push(move(batch))) {
+                    return;
+                }
+                queue = (queue + 1) % tokenizer_count;
+                batch = RecordBatch{};
+                batch.records.reserve(batch_size);
+            }
+        }
+        if (!batch.records.empty()) {
+            if (!record_queues[queue]->Push(move(batch))) {
+                return;
+            }
+            queue = (queue + 1) % tokenizer_count;
+        }
+        for (size_t i = 0; i < tokenizer_count; ++i) {
+            RecordBatch last;
+            last.is_last = true;
+            if (!record_queues[(queue + i) % tokenizer_count]->Push(move(last))) {
+                return;
+            }
+        }
+    });
+
+    for (size_t i = 0; i < tokenizer_count; ++i) {
+        pipeline.threads.emplace_back([&, i] {
+            while (true) {
+                optional<RecordBatch> popped = record_queues[i]->Pop();
+                if (!popped) {
+                    return;
+                }
+                RecordBatch& batch = *popped;
+                const bool is_last = batch.is_last;
+                TokenizedBatch tokenized;
+                tokenized.is_last = is_last;
+                tokenized.words.reserve(batch.records.size());
+                tokenized.is_valid.reserve(batch.records.size());
+                for (const Record& record : batch.records) {
+                    try {
+                        tokenized.words.push_back(search_server.TokenizeDocument(record.text));
+                        tokenized.is_valid.push_back(true);
+                    } catch (const invalid_argument&) {
+                        tokenized.words.emplace_back();
+                        tokenized.is_valid.push_back(false);
+                    }
+                }
+                tokenized.records = move(batch.records);
+                if (!tokenized_queues[i]->Push(move(tokenized)) || is_last) {
+                    return;
+                }
+            }
+        });
+    }
+
+    CorpusLoadStats stats;
+    stats.bytes = data.size();
+    for (size_t queue = 0;; queue = (queue + 1) % tokenizer_count) {
+        const optional<TokenizedBatch> popped = tokenized_queues[queue]->Pop();
+        if (!popped || popped->is_last) {
+            break;
+        }
+        const TokenizedBatch& batch = *popped;
+        for (size_t i = 0; i < batch.records.size(); ++i) {
+            if (!batch.is_valid[i]) {
+                ++stats.rejected_documents;
+                continue;
+            }
+            try {
+                search_server.AddTokenizedDocument(batch.records[i].document_id, batch.records[i].text,
+                                                   batch.words[i], options.status, {});
+                ++stats.documents;
+            } catch (const invalid_argument&) {
+                ++stats.rejected_documents;
+            }
+        }
+    }
+
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return stats;
+}
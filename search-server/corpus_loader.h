@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include "search_server.h"
+
+//Загрузка корпуса из файла: одна строка - один документ, id документа - номер строки
+//плюс first_document_id, пустые строки пропускаются.
+//Файл отображается в память, строки передаются в индекс как string_view
+//без копирования. Чтение, разбиение на слова (tokenizer_count потоков) и добавление
+//в индекс работают конвейером через ограниченные SPSC-очереди.
+struct CorpusLoadOptions {
+    int first_document_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    size_t tokenizer_count = 2;
+    size_t batch_size = 256;
+    size_t queue_capacity = 16;
+};
+
+struct CorpusLoadStats {
+    size_t bytes = 0;
+    size_t documents = 0;
+    //документы с недопустимыми словами или уже занятым id
+    size_t rejected_documents = 0;
+    double seconds = 0.0;
+};
+
+CorpusLoadStats LoadCorpus(SearchServer& search_server, const std::string& path,
+                           const CorpusLoadOptions& options = {});
@@ -0,0 +1,72 @@
+#include "index_statistics.h"
+#include <string>
+
+using namespace std;
+
+namespace {
+
+void WriteMetricHeader(ostream& out, string_view prefix, string_view name,
+                       string_view type, string_view help) {
+    out << "# HELP "s << prefix << '_' << name << ' ' << help << '\n';
+    out << "# TYPE "s << prefix << '_' << name << ' ' << type << '\n';
+}
+
+template <typename Value>
+void WriteGauge(ostream& out, string_view prefix, string_view name,
+                string_view help, Value value) {
+    WriteMetricHeader(out, prefix, name, "gauge"sv, help);
+    out << prefix << '_' << name << ' ' << value << '\n';
+}
+
+}  // namespace
+
+size_t IndexMemoryUsage::GetTotalBytes() const {
+    return term_arena_bytes + term_dictionary_bytes + postings_bytes + positions_bytes
+           + forward_index_bytes + document_ids_bytes + stop_words_bytes;
+}
+
+void WriteMetrics(ostream& out, const IndexStatistics& statistics, string_view prefix) {
+    WriteGauge(out, prefix, "documents"sv, "Indexed documents."sv, statistics.document_count);
+    WriteGauge(out, prefix, "vocabulary_size"sv, "Distinct indexed words."sv,
+               statistics.vocabulary_size);
+    WriteGauge(out, prefix, "empty_posting_lists"sv,
+               "Words left without documents after removals."sv, statistics.empty_posting_lists);
+
+    //гистограмма Prometheus накопительная: бакет le="N" содержит все списки длиной до N
+    WriteMetricHeader(out, prefix, "posting_length"sv, "histogram"sv,
+                      "Documents per non-empty posting list."sv);
+    size_t cumulative_count = 0;
+    for (size_t i = 0; i < statistics.posting_length_histogram.size(); ++i) {
+        cumulative_count += statistics.posting_length_histogram[i];
+        out << prefix << "_posting_length_bucket{le=\""s << ((size_t{2} << i) - 1) << "\"} "s
+            << cumulative_count << '\n';
+    }
+    out << prefix << "_posting_length_bucket{le=\"+Inf\"} "s << cumulative_count << '\n';
+    out << prefix << "_posting_length_sum "s << statistics.posting_count << '\n';
+    out << prefix << "_posting_length_count "s << cumulative_count << '\n';
+
+    const IndexMemoryUsage& memory = statistics.memory;
+    WriteMetricHeader(out, prefix, "memory_bytes"sv, "gauge"sv,
+                      "Estimated bytes used by index structures."sv);
+    const pair<string_view, size_t> structures[] = {
+        {"term_arena"sv, memory.term_arena_bytes},
+        {"term_dictionary"sv, memory.term_dictionary_bytes},
+        {"postings"sv, memory.postings_bytes},
+        {"positions"sv, memory.positions_bytes},
+        {"forward_index"sv, memory.forward_index_bytes},
+        {"document_ids"sv, memory.document_ids_bytes},
+        {"stop_words"sv, memory.stop_words_bytes},
+    };
+    for (const auto& [structure, bytes] : structures) {
+        out << prefix << "_memory_bytes{structure=\""s << structure << "\"} "s << bytes << '\n';
+    }
+    WriteGauge(out, prefix, "memory_bytes_total"sv, "Estimated bytes used by the index."sv,
+               memory.GetTotalBytes());
+
+    WriteGauge(out, prefix, "term_arena_fragmentation_ratio"sv,
+               "Share of term arena blocks not occupied by words."sv,
+               statistics.term_arena_fragmentation);
+    WriteGauge(out, prefix, "document_ids_slack_ratio"sv,
+               "Share of document id array capacity not occupied by documents."sv,
+               statistics.document_ids_slack);
+}
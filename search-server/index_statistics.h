@@ -0,0 +1,42 @@
+#pragma once
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+//Размеры структур индекса в байтах. Узлы std::map и хеш-таблицы считаются
+//по их устройству в libstdc++ без учёта служебных данных аллокатора,
+//поэтому это оценка снизу.
+struct IndexMemoryUsage {
+    //блоки с символами слов, массив string_view и хеш-таблица номеров слов
+    size_t term_arena_bytes = 0;
+    size_t term_dictionary_bytes = 0;
+    size_t postings_bytes = 0;
+    size_t positions_bytes = 0;
+    //документы с их частотами слов
+    size_t forward_index_bytes = 0;
+    size_t document_ids_bytes = 0;
+    size_t stop_words_bytes = 0;
+
+    size_t GetTotalBytes() const;
+};
+
+struct IndexStatistics {
+    size_t document_count = 0;
+    size_t vocabulary_size = 0;
+    //число пар (слово, документ)
+    size_t posting_count = 0;
+    //слова, у которых после RemoveDocument не осталось документов:
+    //слова из индекса не удаляются, их списки продолжают занимать память
+    size_t empty_posting_lists = 0;
+    //posting_length_histogram[i] - число непустых списков длиной от 2^i до 2^(i+1)-1
+    std::vector<size_t> posting_length_histogram;
+    IndexMemoryUsage memory;
+    //доля байтов блоков хранилища слов, не занятых словами
+    double term_arena_fragmentation = 0.0;
+    //доля ёмкости массива id документов, не занятой документами
+    double document_ids_slack = 0.0;
+};
+
+//Вывод в текстовом формате Prometheus, имена метрик начинаются с prefix
+void WriteMetrics(std::ostream& out, const IndexStatistics& statistics,
+                  std::string_view prefix = "search_server");
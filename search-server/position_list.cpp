@@ -0,0 +1,40 @@
+#include "position_list.h"
+
+using namespace std;
+
+vector<uint8_t> EncodePositions(const vector<int>& positions) {
+    vector<uint8_t> encoded;
+    encoded.reserve(positions.size());
+    int previous = 0;
+    for (const int position : positions) {
+        uint32_t delta = position - previous;
+        previous = position;
+        while (delta >= 0x80) {
+            encoded.push_back(static_cast<uint8_t>(delta | 0x80));
+            delta >>= 7;
+        }
+        encoded.push_back(static_cast<uint8_t>(delta));
+    }
+    encoded.shrink_to_fit();
+    return encoded;
+}
+
+vector<int> DecodePositions(const vector<uint8_t>& encoded) {
+    vector<int> positions;
+    positions.reserve(encoded.size());
+    int previous = 0;
+    uint32_t delta = 0;
+    int shift = 0;
+    for (const uint8_t byte : encoded) {
+        delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+        previous += delta;
+        positions.push_back(previous);
+        delta = 0;
+        shift = 0;
+    }
+    return positions;
+}
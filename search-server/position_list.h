@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+//Позиции слова в документе хранятся разностями между соседними позициями,
+//каждая разность записывается переменным числом байт (по 7 бит в байте).
+
+std::vector<uint8_t> EncodePositions(const std::vector<int>& positions);
+
+std::vector<int> DecodePositions(const std::vector<uint8_t>& encoded);
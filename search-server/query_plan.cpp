@@ -0,0 +1,27 @@
+#include "query_plan.h"
+#include <string>
+
+using namespace std;
+
+ostream& operator<<(ostream& out, const QueryPlan& plan) {
+    if (plan.is_empty) {
+        return out << "empty result"s << '\n';
+    }
+    out << (plan.execution == QueryExecution::DOCUMENT_AT_A_TIME
+                ? "document-at-a-time"s
+                : "term-at-a-time"s)
+        << ", "s
+        << (plan.parallelism == QueryParallelism::PARALLEL ? "parallel"s : "sequential"s)
+        << ", "s << plan.posting_volume << " postings"s << '\n';
+    for (const PlannedTerm& term : plan.minus_terms) {
+        out << "  -"s << term.word << ": "s << term.posting_length << " postings"s << '\n';
+    }
+    for (const PlannedTerm& term : plan.plus_terms) {
+        out << "  +"s << term.word << ": "s << term.posting_length << " postings, weight "s
+            << term.weight << ", upper bound "s << term.upper_bound << '\n';
+    }
+    if (plan.phrase_count > 0) {
+        out << "  phrases: "s << plan.phrase_count << '\n';
+    }
+    return out;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+//TERM_AT_A_TIME накапливает релевантность, проходя списки документов по одному слову,
+//DOCUMENT_AT_A_TIME идёт по спискам всех слов сразу в порядке id документов
+//и отбрасывает документы, которые уже не могут попасть в топ (MaxScore)
+enum class QueryExecution {
+    TERM_AT_A_TIME,
+    DOCUMENT_AT_A_TIME,
+};
+
+enum class QueryParallelism {
+    SEQUENTIAL,
+    PARALLEL,
+};
+
+struct PlannedTerm {
+    std::string_view word;
+    uint32_t term_id;
+    size_t posting_length;
+    //вес слова (IDF) и наибольший вклад слова в релевантность одного документа
+    double weight;
+    double upper_bound;
+};
+
+//Слова без документов в план не попадают: на результат они не влияют.
+struct QueryPlan {
+    //проверяются до подсчёта релевантности, начиная с самого длинного списка
+    std::vector<PlannedTerm> minus_terms;
+    //в порядке обработки
+    std::vector<PlannedTerm> plus_terms;
+    size_t phrase_count = 0;
+    //сумма длин списков плюс-слов
+    size_t posting_volume = 0;
+    //результат заведомо пуст, поиск не выполняется
+    bool is_empty = false;
+    QueryExecution execution = QueryExecution::TERM_AT_A_TIME;
+    QueryParallelism parallelism = QueryParallelism::SEQUENTIAL;
+};
+
+std::ostream& operator<<(std::ostream& out, const QueryPlan& plan);
@@ -0,0 +1,54 @@
+#pragma once
+#include <cmath>
+
+//Скореры подставляются в FindAllDocuments как шаблонный параметр,
+//поэтому во внутреннем цикле по документам нет виртуальных вызовов.
+//ComputeTermWeight считается один раз на слово запроса,
+//ComputeScore - для каждой пары (слово, документ),
+//ComputeUpperBound - верхняя граница вклада слова в релевантность любого документа.
+
+struct TfIdfScorer {
+    double ComputeTermWeight(int document_count, int document_freq) const {
+        return std::log(document_count * 1.0 / document_freq);
+    }
+
+    double ComputeScore(double term_weight, double term_freq,
+                        int /*document_length*/, double /*average_document_length*/) const {
+        return term_freq * term_weight;
+    }
+
+    double ComputeUpperBound(double term_weight) const {
+        //term_freq - доля слова в документе, она не больше единицы
+        return term_weight;
+    }
+};
+
+struct Bm25Scorer {
+    Bm25Scorer() = default;
+
+    Bm25Scorer(double k1, double b)
+        : k1(k1)
+        , b(b) {
+    }
+
+    double ComputeTermWeight(int document_count, int document_freq) const {
+        return std::log(1.0 + (document_count - document_freq + 0.5) / (document_freq + 0.5));
+    }
+
+    double ComputeScore(double term_weight, double term_freq,
+                        int document_length, double average_document_length) const {
+        //в индексе хранится доля слова в документе, BM25 нужно количество вхождений
+        const double count = term_freq * document_length;
+        const double length_norm = average_document_length > 0
+            ? document_length / average_document_length
+            : 1.0;
+        return term_weight * count * (k1 + 1.0) / (count + k1 * (1.0 - b + b * length_norm));
+    }
+
+    double ComputeUpperBound(double term_weight) const {
+        return term_weight * (k1 + 1.0);
+    }
+
+    double k1 = 1.2;
+    double b = 0.75;
+};
@@ -1,46 +1,195 @@
 #include "search_server.h"
 #include <math.h>
+#include <charconv>
+#include <numeric>
+#include <thread>
 
 using namespace std;
 
+namespace {
 
-SearchServer::SearchServer(const std::string& stop_words_text)
-: SearchServer(SplitIntoWords(stop_words_text)) {
+//узел std::map в libstdc++: цвет, родитель, два ребёнка и значение
+template <typename Map>
+constexpr size_t MAP_NODE_BYTES = 4 * sizeof(void*) + sizeof(typename Map::value_type);
+
+//DOCUMENT_AT_A_TIME на каждом документе перебирает курсоры всех слов, поэтому при большом
+//числе слов (раскрытые * и ~) выгоднее накапливать релевантность по словам
+const size_t MAX_DOCUMENT_AT_A_TIME_TERMS = 16;
+//на меньшем объёме списков запуск потоков par обходится дороже самого поиска
+const size_t MIN_PARALLEL_POSTING_VOLUME = 1 << 16;
+
+//Отметки удаляемых документов. Если id пачки идут плотно, это битовая карта
+//от наименьшего id до наибольшего, иначе - поиск в отсортированной пачке.
+class Tombstones {
+public:
+    //карта не больше стольких бит на удаляемый документ
+    static constexpr size_t MAX_BITS_PER_DOCUMENT = 64;
+
+    explicit Tombstones(const vector<int>& sorted_document_ids)
+    : sorted_document_ids_(sorted_document_ids) {
+        if (sorted_document_ids.empty()) {
+            return;
+        }
+        first_document_id_ = sorted_document_ids.front();
+        const size_t span = static_cast<size_t>(sorted_document_ids.back() - first_document_id_) + 1;
+        if (span <= sorted_document_ids.size() * MAX_BITS_PER_DOCUMENT) {
+            is_removed_.resize(span);
+            for (const int document_id : sorted_document_ids) {
+                is_removed_[document_id - first_document_id_] = true;
+            }
+        }
+    }
+
+    bool IsRemoved(int document_id) const {
+        if (is_removed_.empty()) {
+            return binary_search(sorted_document_ids_.begin(), sorted_document_ids_.end(), document_id);
+        }
+        return document_id >= first_document_id_
+               && static_cast<size_t>(document_id - first_document_id_) < is_removed_.size()
+               && is_removed_[document_id - first_document_id_];
+    }
+
+private:
+    const vector<int>& sorted_document_ids_;
+    int first_document_id_ = 0;
+    vector<bool> is_removed_;
+};
+
+size_t GetLengthBucket(size_t length) {
+    size_t bucket = 0;
+    while (length >>= 1) {
+        ++bucket;
+    }
+    return bucket;
+}
+
+}  // namespace
+
+
+SearchServer::SearchServer(const std::string& stop_words_text, IndexOptions options)
+: SearchServer(SplitIntoWords(stop_words_text), options) {
 }
 
-SearchServer::SearchServer(string_view stop_words_text)
-: SearchServer(SplitIntoWords(stop_words_text)) {
+SearchServer::SearchServer(string_view stop_words_text, IndexOptions options)
+: SearchServer(SplitIntoWords(stop_words_text), options) {
 }
 
 void SearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+    AddTokenizedDocument(document_id, document, SplitIntoWordsNoStop(document), status, ratings);
+}
+
+vector<string_view> SearchServer::TokenizeDocument(string_view document) const {
+    return SplitIntoWordsNoStop(document);
+}
+
+void SearchServer::AddTokenizedDocument(int document_id, string_view document,
+                                        const vector<string_view>& words,
+                                        DocumentStatus status, const vector<int>& ratings) {
     if ((document_id < 0) || (documents_.count(document_id) > 0)) {
         throw invalid_argument("Invalid document_id"s);
     }
-    const auto words = SplitIntoWordsNoStop(document);
     const double inv_word_count = 1.0 / words.size();
-    map<string_view, double> frequency_of_words;
+    vector<uint32_t> term_ids;
+    term_ids.reserve(words.size());
     for (string_view word_view : words) {
-        string word(word_view);
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        frequency_of_words[word_to_document_freqs_.find(word)->first] += inv_word_count;
+        term_ids.push_back(AddTerm(word_view));
     }
-    documents_.insert({document_id, DocumentData{ComputeAverageRating(ratings), status, frequency_of_words}});
+    sort(term_ids.begin(), term_ids.end());
+    vector<pair<uint32_t, double>> term_freqs;
+    for (const uint32_t term_id : term_ids) {
+        if (term_freqs.empty() || term_freqs.back().first != term_id) {
+            term_freqs.push_back({term_id, 0.0});
+        }
+        term_freqs.back().second += inv_word_count;
+    }
+    term_freqs.shrink_to_fit();
+    for (const auto& [term_id, term_freq] : term_freqs) {
+        postings_[term_id].emplace_hint(postings_[term_id].end(), document_id, term_freq);
+        OnPostingListResized(postings_[term_id].size() - 1, postings_[term_id].size());
+    }
+    documents_.insert({document_id, DocumentData{ComputeAverageRating(ratings), status,
+                                                 move(term_freqs), static_cast<int>(words.size())}});
     document_ids_.push_back(document_id);
+    total_word_count_ += words.size();
+    if (index_options_ == IndexOptions::POSITIONS) {
+        IndexPositions(document_id, document);
+    }
 }
 
 vector<Document> SearchServer::FindTopDocuments(
     string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(execution::seq, raw_query, status);
+    return FindTopDocuments(
+        raw_query,
+        [status](int /*document_id*/, DocumentStatus document_status, int /*rating*/) {
+            return document_status == status;
+        });
 }
 
 vector<Document> SearchServer::FindTopDocuments(string_view raw_query) const {
-    return FindTopDocuments(execution::seq, raw_query);
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
 int SearchServer::GetDocumentCount() const {
     return documents_.size();
 }
 
+QueryPlan SearchServer::Explain(string_view raw_query) const {
+    return BuildQueryPlan(ParseQuery(raw_query), GetCorpusStatistics(), nullopt);
+}
+
+IndexStatistics SearchServer::GetIndexStatistics() const {
+    IndexStatistics statistics;
+    statistics.document_count = documents_.size();
+    statistics.vocabulary_size = terms_.GetTermCount();
+    statistics.posting_count = posting_count_;
+    statistics.empty_posting_lists = empty_posting_lists_;
+    size_t bucket_count = posting_length_histogram_.size();
+    while (bucket_count > 0 && posting_length_histogram_[bucket_count - 1] == 0) {
+        --bucket_count;
+    }
+    statistics.posting_length_histogram.assign(posting_length_histogram_.begin(),
+                                               posting_length_histogram_.begin() + bucket_count);
+
+    IndexMemoryUsage& memory = statistics.memory;
+    memory.term_arena_bytes = terms_.GetReservedBytes() + terms_.GetIndexBytes();
+    memory.term_dictionary_bytes = term_dictionary_.GetMemoryBytes();
+    memory.postings_bytes = postings_.capacity() * sizeof(postings_[0])
+                            + posting_count_ * MAP_NODE_BYTES<map<int, double>>;
+    //у каждой пары (слово, документ) в режиме POSITIONS есть свой список позиций
+    memory.positions_bytes = positions_.capacity() * sizeof(positions_[0])
+                             + position_list_bytes_;
+    if (index_options_ == IndexOptions::POSITIONS) {
+        memory.positions_bytes += posting_count_ * MAP_NODE_BYTES<map<int, vector<uint8_t>>>;
+    }
+    //частоты документа лежат в векторе без запаса (shrink_to_fit в AddTokenizedDocument)
+    memory.forward_index_bytes = documents_.size() * MAP_NODE_BYTES<map<int, DocumentData>>
+                                 + posting_count_ * sizeof(pair<uint32_t, double>);
+    memory.document_ids_bytes = document_ids_.capacity() * sizeof(int);
+    //стоп-слова не меняются после создания сервера и их обычно немного
+    memory.stop_words_bytes = transform_reduce(
+        stop_words_.begin(), stop_words_.end(), size_t{0}, plus<>{},
+        [](const string& word) {
+            return MAP_NODE_BYTES<set<string, less<>>> + (word.capacity() > 15 ? word.capacity() + 1 : 0);
+        });
+
+    if (terms_.GetReservedBytes() > 0) {
+        statistics.term_arena_fragmentation =
+            1.0 - terms_.GetUsedBytes() * 1.0 / terms_.GetReservedBytes();
+    }
+    if (document_ids_.capacity() > 0) {
+        statistics.document_ids_slack = 1.0 - document_ids_.size() * 1.0 / document_ids_.capacity();
+    }
+    return statistics;
+}
+
+void SearchServer::SetScorer(const RelevanceScorer& scorer) {
+    scorer_ = scorer;
+}
+
+const RelevanceScorer& SearchServer::GetScorer() const {
+    return scorer_;
+}
+
 vector<int>::iterator SearchServer::begin() {
     return document_ids_.begin();
 }
@@ -49,23 +198,30 @@ vector<int>::iterator SearchServer::end() {
     return document_ids_.end();
 }
 
-const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    if (documents_.count(document_id) > 0) {
-        return documents_.at(document_id).frequency_of_words;
+map<string_view, double> SearchServer::GetWordFrequencies(int document_id) const {
+    map<string_view, double> frequency_of_words;
+    const auto it = documents_.find(document_id);
+    if (it != documents_.end()) {
+        for (const auto& [term_id, term_freq] : it->second.term_freqs) {
+            frequency_of_words.emplace(terms_.GetTerm(term_id), term_freq);
+        }
     }
-    static const map<string_view, double> map_empty;
-    return map_empty;
+    return frequency_of_words;
 }
 
 void SearchServer::RemoveDocument(int document_id) {
-    for (const auto [word_view, _] : documents_[document_id].frequency_of_words) {
-        word_to_document_freqs_[string(word_view)].erase(document_id);
+    const auto document_it = documents_.find(document_id);
+    if (document_it == documents_.end()) {
+        return;
     }
-    documents_.erase(document_id);
-    auto it = lower_bound(document_ids_.begin(), document_ids_.end(), document_id);
-    if (*it == document_id) {
-        document_ids_.erase(it);
+    for (const auto& [term_id, _] : document_it->second.term_freqs) {
+        postings_[term_id].erase(document_id);
+        OnPostingListResized(postings_[term_id].size() + 1, postings_[term_id].size());
+        if (index_options_ == IndexOptions::POSITIONS) {
+            position_list_bytes_ -= ErasePositions(term_id, document_id);
+        }
     }
+    EraseDocument(document_it);
 }
 
 void SearchServer::RemoveDocument(execution::sequenced_policy, int document_id) {
@@ -73,17 +229,104 @@ void SearchServer::RemoveDocument(execution::sequenced_policy, int document_id)
 }
     
 void SearchServer::RemoveDocument(execution::parallel_policy, int document_id) {
-    for_each(execution::par, 
-             documents_[document_id].frequency_of_words.begin(),
-             documents_[document_id].frequency_of_words.end(),
-            [this, document_id](const auto& el) {
-                word_to_document_freqs_[string(el.first)].erase(document_id);
-            });
-    documents_.erase(document_id);
-    auto it = lower_bound(document_ids_.begin(), document_ids_.end(), document_id);
-    if (*it == document_id) {
-        document_ids_.erase(it);
+    const auto document_it = documents_.find(document_id);
+    if (document_it == documents_.end()) {
+        return;
+    }
+    const auto& term_freqs = document_it->second.term_freqs;
+    position_list_bytes_ -= transform_reduce(
+        execution::par,
+        term_freqs.begin(), term_freqs.end(),
+        size_t{0}, plus<>{},
+        [this, document_id](const auto& el) {
+            postings_[el.first].erase(document_id);
+            if (index_options_ == IndexOptions::POSITIONS) {
+                return ErasePositions(el.first, document_id);
+            }
+            return size_t{0};
+        });
+    //счётчики общие для всех слов, поэтому обновляются после параллельного прохода
+    for (const auto& [term_id, _] : term_freqs) {
+        OnPostingListResized(postings_[term_id].size() + 1, postings_[term_id].size());
+    }
+    EraseDocument(document_it);
+}
+
+template <class ExecutionPolicy>
+void SearchServer::RemoveDocumentBatch(ExecutionPolicy&& policy, const vector<int>& document_ids) {
+    vector<int> removed_ids;
+    removed_ids.reserve(document_ids.size());
+    for (const int document_id : document_ids) {
+        if (documents_.count(document_id) > 0) {
+            removed_ids.push_back(document_id);
+        }
+    }
+    sort(policy, removed_ids.begin(), removed_ids.end());
+    removed_ids.erase(unique(removed_ids.begin(), removed_ids.end()), removed_ids.end());
+    if (removed_ids.empty()) {
+        return;
+    }
+
+    //пары (слово, документ); после сортировки удаляемые документы одного слова идут подряд,
+    //и каждое слово чистится одной задачей без блокировок
+    vector<pair<uint32_t, int>> term_documents;
+    for (const int document_id : removed_ids) {
+        for (const auto& [term_id, _] : documents_.at(document_id).term_freqs) {
+            term_documents.push_back({term_id, document_id});
+        }
     }
+    sort(policy, term_documents.begin(), term_documents.end());
+    vector<pair<size_t, size_t>> term_ranges;
+    for (size_t begin = 0, end = 0; begin < term_documents.size(); begin = end) {
+        while (end < term_documents.size() && term_documents[end].first == term_documents[begin].first) {
+            ++end;
+        }
+        term_ranges.push_back({begin, end});
+    }
+    position_list_bytes_ -= transform_reduce(
+        policy,
+        term_ranges.begin(), term_ranges.end(),
+        size_t{0}, plus<>{},
+        [this, &term_documents](const pair<size_t, size_t>& range) {
+            size_t freed_bytes = 0;
+            for (size_t i = range.first; i < range.second; ++i) {
+                const auto [term_id, document_id] = term_documents[i];
+                postings_[term_id].erase(document_id);
+                if (index_options_ == IndexOptions::POSITIONS) {
+                    freed_bytes += ErasePositions(term_id, document_id);
+                }
+            }
+            return freed_bytes;
+        });
+    for (const auto& [begin, end] : term_ranges) {
+        const size_t new_size = postings_[term_documents[begin].first].size();
+        OnPostingListResized(new_size + (end - begin), new_size);
+    }
+
+    for (const int document_id : removed_ids) {
+        const auto document_it = documents_.find(document_id);
+        total_word_count_ -= document_it->second.word_count;
+        documents_.erase(document_it);
+    }
+    const Tombstones tombstones(removed_ids);
+    document_ids_.erase(
+        remove_if(policy, document_ids_.begin(), document_ids_.end(),
+                  [&tombstones](int document_id) {
+                      return tombstones.IsRemoved(document_id);
+                  }),
+        document_ids_.end());
+}
+
+void SearchServer::RemoveDocuments(const vector<int>& document_ids) {
+    RemoveDocuments(execution::seq, document_ids);
+}
+
+void SearchServer::RemoveDocuments(execution::sequenced_policy, const vector<int>& document_ids) {
+    RemoveDocumentBatch(execution::seq, document_ids);
+}
+
+void SearchServer::RemoveDocuments(execution::parallel_policy, const vector<int>& document_ids) {
+    RemoveDocumentBatch(execution::par, document_ids);
 }
 
 tuple<vector<string_view>, DocumentStatus>
@@ -125,6 +368,67 @@ int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
     return rating_sum / static_cast<int>(ratings.size());
 }
 
+uint32_t SearchServer::AddTerm(string_view word) {
+    const uint32_t term_id = terms_.Intern(word);
+    if (term_id == postings_.size()) {
+        postings_.emplace_back();
+        if (index_options_ == IndexOptions::POSITIONS) {
+            positions_.emplace_back();
+        }
+        term_dictionary_.Insert(terms_.GetTerm(term_id), term_id);
+        ++empty_posting_lists_;
+    }
+    return term_id;
+}
+
+void SearchServer::EraseDocument(map<int, DocumentData>::const_iterator document_it) {
+    //id добавляются в порядке AddDocument и не обязаны быть отсортированы
+    const auto id_it = find(document_ids_.begin(), document_ids_.end(), document_it->first);
+    if (id_it != document_ids_.end()) {
+        document_ids_.erase(id_it);
+    }
+    total_word_count_ -= document_it->second.word_count;
+    documents_.erase(document_it);
+}
+
+void SearchServer::OnPostingListResized(size_t old_size, size_t new_size) {
+    if (old_size == new_size) {
+        return;
+    }
+    if (old_size == 0) {
+        --empty_posting_lists_;
+    } else {
+        --posting_length_histogram_[GetLengthBucket(old_size)];
+    }
+    if (new_size == 0) {
+        ++empty_posting_lists_;
+    } else {
+        ++posting_length_histogram_[GetLengthBucket(new_size)];
+    }
+    posting_count_ += new_size;
+    posting_count_ -= old_size;
+}
+
+size_t SearchServer::ErasePositions(uint32_t term_id, int document_id) {
+    const auto it = positions_[term_id].find(document_id);
+    if (it == positions_[term_id].end()) {
+        return 0;
+    }
+    const size_t bytes = it->second.capacity();
+    positions_[term_id].erase(it);
+    return bytes;
+}
+
+const map<int, double>* SearchServer::FindPostings(string_view word) const {
+    const uint32_t term_id = terms_.Find(word);
+    return term_id == TermArena::NO_TERM ? nullptr : &postings_[term_id];
+}
+
+bool SearchServer::ContainsWord(string_view word, int document_id) const {
+    const auto* postings = FindPostings(word);
+    return postings != nullptr && postings->count(document_id) > 0;
+}
+
 SearchServer::QueryWord SearchServer::ParseQueryWord(string_view text) const {
     if (text.empty()) {
         throw invalid_argument("Query word is empty"s);
@@ -141,34 +445,110 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(string_view text) const {
     return {word, is_minus, IsStopWord(word)};
 }
 
+void SearchServer::ExpandQueryWord(string_view word, vector<string_view>& words) const {
+    vector<uint32_t> term_ids;
+    if (word.back() == '*') {
+        const string_view prefix = word.substr(0, word.size() - 1);
+        if (prefix.empty()) {
+            throw invalid_argument("Query word "s + string(word) + " has empty prefix"s);
+        }
+        term_ids = term_dictionary_.FindByPrefix(prefix);
+    } else {
+        const size_t tilde = word.rfind('~');
+        int max_distance = 0;
+        const auto [end, error] = from_chars(word.data() + tilde + 1, word.data() + word.size(), max_distance);
+        if (tilde == 0 || tilde + 1 == word.size() || error != errc() || end != word.data() + word.size()) {
+            //это не запрос с опечатками, а обычное слово с тильдой
+            words.push_back(word);
+            return;
+        }
+        if (max_distance < 0) {
+            throw invalid_argument("Query word "s + string(word) + " has negative distance"s);
+        }
+        term_ids = term_dictionary_.FindWithinDistance(word.substr(0, tilde), max_distance);
+    }
+    for (const uint32_t term_id : term_ids) {
+        //после RemoveDocument в индексе остаются слова без документов
+        if (!postings_[term_id].empty()) {
+            words.push_back(terms_.GetTerm(term_id));
+        }
+    }
+}
+
+void SearchServer::AddQueryWord(Query& query, const QueryWord& query_word) const {
+    if (query_word.is_stop) {
+        return;
+    }
+    auto& words = query_word.is_minus ? query.minus_words : query.plus_words;
+    if (query_word.data.back() == '*' || query_word.data.find('~') != string_view::npos) {
+        ExpandQueryWord(query_word.data, words);
+    } else {
+        words.push_back(query_word.data);
+    }
+}
+
+SearchServer::Phrase SearchServer::ParsePhrase(string_view text, int slop) const {
+    Phrase phrase;
+    phrase.slop = slop;
+    int offset = 0;
+    for (string_view word_view : SplitIntoWords(text)) {
+        QueryWord query_word = ParseQueryWord(word_view);
+        if (query_word.is_minus) {
+            throw invalid_argument("Minus word "s + string(word_view) + " inside a phrase"s);
+        }
+        if (!query_word.is_stop) {
+            phrase.words.push_back(query_word.data);
+            phrase.offsets.push_back(offset);
+        }
+        ++offset;
+    }
+    return phrase;
+}
+
 SearchServer::Query SearchServer::ParseQueryNoSort(string_view text) const {
     //Я внедрил алгоритм метода SplitIntoWords сюда, не использовав сам метод,
     //это дало небольшой выигрыш по времени
     Query result;
     size_t space;
     while (true) {
+        if (!text.empty() && text[0] == '"') {
+            if (index_options_ != IndexOptions::POSITIONS) {
+                throw invalid_argument("Phrase queries require IndexOptions::POSITIONS"s);
+            }
+            const size_t closing = text.find('"', 1);
+            if (closing == string_view::npos) {
+                throw invalid_argument("Query phrase "s + string(text) + " is not closed"s);
+            }
+            const string_view phrase_text = text.substr(1, closing - 1);
+            text.remove_prefix(closing + 1);
+            space = text.find(' ');
+            const string_view suffix = text.substr(0, space);
+            int slop = 0;
+            if (!suffix.empty()) {
+                const auto [end, error] = from_chars(suffix.data() + 1, suffix.data() + suffix.size(), slop);
+                if (suffix[0] != '~' || error != errc() || end != suffix.data() + suffix.size() || slop < 0) {
+                    throw invalid_argument("Query phrase suffix "s + string(suffix) + " is invalid"s);
+                }
+            }
+            Phrase phrase = ParsePhrase(phrase_text, slop);
+            if (!phrase.words.empty()) {
+                result.plus_words.insert(result.plus_words.end(), phrase.words.begin(), phrase.words.end());
+                result.phrases.push_back(move(phrase));
+            }
+            if (space >= string_view::npos) {
+                break;
+            }
+            text.remove_prefix(space + 1);
+            continue;
+        }
         space = text.find(' ');
         if (space >= string_view::npos) {
             if (!text.empty()) {
-                QueryWord query_word = ParseQueryWord(text);
-                if (!query_word.is_stop) {
-                    if (query_word.is_minus) {
-                        result.minus_words.push_back(query_word.data);
-                    } else {
-                        result.plus_words.push_back(query_word.data);
-                    }
-                }
+                AddQueryWord(result, ParseQueryWord(text));
             }
             break;
         }
-        QueryWord query_word = ParseQueryWord(text.substr(0, space));
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                result.minus_words.push_back(query_word.data);
-            } else {
-                result.plus_words.push_back(query_word.data);
-            }
-        }
+        AddQueryWord(result, ParseQueryWord(text.substr(0, space)));
         text.remove_prefix(space + 1);
     }
     return result;
@@ -187,6 +567,234 @@ SearchServer::Query SearchServer::ParseQuery(string_view text) const {
     return result;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const string& word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+void SearchServer::IndexPositions(int document_id, string_view document) {
+    //пары (номер слова, позиция); после сортировки позиции одного слова идут подряд и по возрастанию
+    vector<pair<uint32_t, int>> term_positions;
+    int position = 0;
+    for (string_view word_view : SplitIntoWords(document)) {
+        if (!IsStopWord(word_view)) {
+            term_positions.push_back({terms_.Find(word_view), position});
+        }
+        ++position;
+    }
+    sort(term_positions.begin(), term_positions.end());
+    vector<int> positions;
+    for (size_t i = 0; i < term_positions.size(); ++i) {
+        positions.push_back(term_positions[i].second);
+        if (i + 1 == term_positions.size() || term_positions[i + 1].first != term_positions[i].first) {
+            auto& encoded = positions_[term_positions[i].first][document_id];
+            encoded = EncodePositions(positions);
+            position_list_bytes_ += encoded.capacity();
+            positions.clear();
+        }
+    }
+}
+
+bool SearchServer::MatchPhrase(const Phrase& phrase, int document_id) const {
+    vector<vector<int>> positions;
+    positions.reserve(phrase.words.size());
+    for (string_view word_view : phrase.words) {
+        const uint32_t term_id = terms_.Find(word_view);
+        if (term_id == TermArena::NO_TERM) {
+            return false;
+        }
+        const auto document_it = positions_[term_id].find(document_id);
+        if (document_it == positions_[term_id].end()) {
+            return false;
+        }
+        positions.push_back(DecodePositions(document_it->second));
+    }
+    if (positions.empty()) {
+        return true;
+    }
+    if (phrase.slop == 0) {
+        for (const int start : positions[0]) {
+            bool is_match = true;
+            for (size_t i = 1; i < positions.size() && is_match; ++i) {
+                is_match = binary_search(positions[i].begin(), positions[i].end(),
+                                         start + phrase.offsets[i] - phrase.offsets[0]);
+            }
+            if (is_match) {
+                return true;
+            }
+        }
+        return false;
+    }
+    //близость: ищем окно, в котором встречаются все слова фразы. Повторяющееся слово
+    //должно встретиться в окне столько раз, сколько во фразе, - на разных позициях
+    const int max_window = phrase.offsets.back() - phrase.offsets.front() + phrase.slop;
+    vector<string_view> distinct_words;
+    vector<int> required_counts;
+    //пары (позиция, номер слова в distinct_words)
+    vector<pair<int, size_t>> occurrences;
+    for (size_t i = 0; i < phrase.words.size(); ++i) {
+        const size_t word = find(distinct_words.begin(), distinct_words.end(), phrase.words[i])
+                            - distinct_words.begin();
+        if (word < distinct_words.size()) {
+            ++required_counts[word];
+            continue;
+        }
+        distinct_words.push_back(phrase.words[i]);
+        required_counts.push_back(1);
+        for (const int position : positions[i]) {
+            occurrences.push_back({position, word});
+        }
+    }
+    sort(occurrences.begin(), occurrences.end());
+    vector<int> counts(distinct_words.size(), 0);
+    size_t missing_words = distinct_words.size();
+    size_t left = 0;
+    for (size_t right = 0; right < occurrences.size(); ++right) {
+        if (++counts[occurrences[right].second] == required_counts[occurrences[right].second]) {
+            --missing_words;
+        }
+        //сужаем окно слева, пока в нём есть все слова
+        while (missing_words == 0) {
+            if (occurrences[right].first - occurrences[left].first <= max_window) {
+                return true;
+            }
+            if (counts[occurrences[left].second]-- == required_counts[occurrences[left].second]) {
+                ++missing_words;
+            }
+            ++left;
+        }
+    }
+    return false;
+}
+
+vector<int> SearchServer::FindPhraseDocuments(const vector<Phrase>& phrases) const {
+    vector<int> result;
+    bool is_first = true;
+    for (const Phrase& phrase : phrases) {
+        vector<const map<int, double>*> document_freqs;
+        for (string_view word_view : phrase.words) {
+            const auto* postings = FindPostings(word_view);
+            if (postings == nullptr) {
+                return {};
+            }
+            document_freqs.push_back(postings);
+        }
+        //пересекаем списки документов, начиная с самого короткого,
+        //и только у оставшихся кандидатов декодируем позиции
+        sort(document_freqs.begin(), document_freqs.end(),
+             [](const auto* lhs, const auto* rhs) {
+                 return lhs->size() < rhs->size();
+             });
+        vector<int> phrase_documents;
+        for (const auto [document_id, _] : *document_freqs[0]) {
+            if (!is_first && !binary_search(result.begin(), result.end(), document_id)) {
+                continue;
+            }
+            if (all_of(document_freqs.begin() + 1, document_freqs.end(),
+                       [document_id](const auto* freqs) {
+                           return freqs->count(document_id) > 0;
+                       }) && MatchPhrase(phrase, document_id)) {
+                phrase_documents.push_back(document_id);
+            }
+        }
+        result = move(phrase_documents);
+        is_first = false;
+        if (result.empty()) {
+            break;
+        }
+    }
+    return result;
+}
+
+double SearchServer::ComputeAverageDocumentLength() const {
+    if (documents_.empty()) {
+        return 0.0;
+    }
+    return total_word_count_ * 1.0 / documents_.size();
+}
+
+QueryPlan SearchServer::BuildQueryPlan(const Query& query, const CorpusStatistics& statistics,
+                                       optional<QueryParallelism> parallelism) const {
+    QueryPlan plan;
+    plan.phrase_count = query.phrases.size();
+    const auto add_terms = [this](const vector<string_view>& words, vector<PlannedTerm>& terms) {
+        for (string_view word_view : words) {
+            const uint32_t term_id = terms_.Find(word_view);
+            if (term_id != TermArena::NO_TERM && !postings_[term_id].empty()) {
+                terms.push_back({terms_.GetTerm(term_id), term_id, postings_[term_id].size(), 0.0, 0.0});
+            }
+        }
+    };
+    add_terms(query.plus_words, plan.plus_terms);
+    add_terms(query.minus_words, plan.minus_terms);
+    visit([&](const auto& scorer) {
+        for (PlannedTerm& term : plan.plus_terms) {
+            const auto global_freq = statistics.document_freqs.find(term.word);
+            term.weight = scorer.ComputeTermWeight(
+                statistics.document_count,
+                global_freq != statistics.document_freqs.end()
+                    ? global_freq->second
+                    : static_cast<int>(term.posting_length));
+            term.upper_bound = scorer.ComputeUpperBound(term.weight);
+            plan.posting_volume += term.posting_length;
+        }
+    }, scorer_);
+
+    //минус-слово из всех документов исключает всё, как и фраза со словом не из индекса
+    const bool is_all_excluded = any_of(plan.minus_terms.begin(), plan.minus_terms.end(),
+        [this](const PlannedTerm& term) {
+            return term.posting_length == documents_.size();
+        });
+    const bool has_unknown_phrase_word = any_of(query.phrases.begin(), query.phrases.end(),
+        [this](const Phrase& phrase) {
+            return any_of(phrase.words.begin(), phrase.words.end(), [this](string_view word_view) {
+                const auto* postings = FindPostings(word_view);
+                return postings == nullptr || postings->empty();
+            });
+        });
+    plan.is_empty = plan.plus_terms.empty() || is_all_excluded || has_unknown_phrase_word;
+
+    //длинный список минус-слова скорее исключит документ, его проверяем первым
+    sort(plan.minus_terms.begin(), plan.minus_terms.end(),
+         [](const PlannedTerm& lhs, const PlannedTerm& rhs) {
+             return lhs.posting_length > rhs.posting_length;
+         });
+
+    if (!parallelism) {
+        const bool is_large = plan.plus_terms.size() > MAX_DOCUMENT_AT_A_TIME_TERMS
+                              && plan.posting_volume >= MIN_PARALLEL_POSTING_VOLUME
+                              && thread::hardware_concurrency() > 1;
+        parallelism = is_large ? QueryParallelism::PARALLEL : QueryParallelism::SEQUENTIAL;
+    }
+    plan.parallelism = *parallelism;
+    //DOCUMENT_AT_A_TIME идёт по документам последовательно, par распределяет по потокам слова
+    plan.execution = plan.parallelism == QueryParallelism::SEQUENTIAL
+                     && plan.plus_terms.size() <= MAX_DOCUMENT_AT_A_TIME_TERMS
+        ? QueryExecution::DOCUMENT_AT_A_TIME
+        : QueryExecution::TERM_AT_A_TIME;
+    if (plan.execution == QueryExecution::DOCUMENT_AT_A_TIME) {
+        //MaxScore отбрасывает слова с наименьшим возможным вкладом
+        sort(plan.plus_terms.begin(), plan.plus_terms.end(),
+             [](const PlannedTerm& lhs, const PlannedTerm& rhs) {
+                 return lhs.upper_bound < rhs.upper_bound;
+             });
+    } else {
+        //сначала короткие списки редких слов
+        sort(plan.plus_terms.begin(), plan.plus_terms.end(),
+             [](const PlannedTerm& lhs, const PlannedTerm& rhs) {
+                 return lhs.posting_length < rhs.posting_length;
+             });
+    }
+    return plan;
+}
+
+bool SearchServer::IsExcluded(const QueryPlan& plan, int document_id) const {
+    return any_of(plan.minus_terms.begin(), plan.minus_terms.end(),
+                  [this, document_id](const PlannedTerm& term) {
+                      return postings_[term.term_id].count(document_id) > 0;
+                  });
+}
+
+SearchServer::CorpusStatistics SearchServer::GetCorpusStatistics() const {
+    return {GetDocumentCount(), ComputeAverageDocumentLength(), {}};
+}
+
+int SearchServer::GetDocumentFreq(string_view word) const {
+    const auto* postings = FindPostings(word);
+    return postings == nullptr ? 0 : static_cast<int>(postings->size());
 }
\ No newline at end of file
@@ -3,27 +3,56 @@
 #include <map>
 #include <set>
 #include <algorithm>
+#include <array>
 #include <stdexcept>
 #include <execution>
+#include <limits>
+#include <optional>
+#include <queue>
 #include <type_traits>
+#include <variant>
 #include "document.h"
 #include "string_processing.h"
 #include "concurrent_map.h"
+#include "relevance_scorer.h"
+#include "position_list.h"
+#include "term_dictionary.h"
+#include "term_arena.h"
+#include "index_statistics.h"
+#include "query_plan.h"
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
+//релевантности ближе этого считаются равными, тогда выше документ с большим рейтингом
+const double RELEVANCE_EPSILON = 1e-6;
+
+using RelevanceScorer = std::variant<TfIdfScorer, Bm25Scorer>;
+
+//POSITIONS дополнительно хранит позиции слов и включает фразовые запросы
+//("black cat") и запросы близости ("black cat"~3)
+enum class IndexOptions {
+    FREQUENCIES,
+    POSITIONS,
+};
+
+struct CorpusLoadOptions;
+struct CorpusLoadStats;
 
 class SearchServer {
 public:
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words);
+    explicit SearchServer(const StringContainer& stop_words,
+                          IndexOptions options = IndexOptions::FREQUENCIES);
 
-    explicit SearchServer(const std::string& stop_words_text);
+    explicit SearchServer(const std::string& stop_words_text,
+                          IndexOptions options = IndexOptions::FREQUENCIES);
     
-    explicit SearchServer(std::string_view stop_words_text);
+    explicit SearchServer(std::string_view stop_words_text,
+                          IndexOptions options = IndexOptions::FREQUENCIES);
 
     void AddDocument(int document_id, std::string_view document,
                      DocumentStatus status, const std::vector<int>& ratings);
 
+    //Без явной политики seq или par выбирает планировщик запроса
     template <typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(
         std::string_view raw_query, DocumentPredicate document_predicate) const;
@@ -46,12 +75,23 @@ public:
         ExecutionPolicy&& policy, std::string_view raw_query) const;
 
     int GetDocumentCount() const;
+
+    //План, по которому выполнится FindTopDocuments(raw_query)
+    QueryPlan Explain(std::string_view raw_query) const;
+
+    //Статистика и оценка занимаемой памяти. Собирается из счётчиков, которые
+    //обновляются при добавлении и удалении документов, без обхода индекса.
+    IndexStatistics GetIndexStatistics() const;
+
+    void SetScorer(const RelevanceScorer& scorer);
+
+    const RelevanceScorer& GetScorer() const;
     
     std::vector<int>::iterator begin();
     
     std::vector<int>::iterator end();
     
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
     
     void RemoveDocument(int document_id);
     
@@ -59,23 +99,54 @@ public:
     
     void RemoveDocument(std::execution::parallel_policy, int document_id);
 
+    //Удаление пачки документов, отсутствующие id пропускаются. Списки документов
+    //чистятся по словам (с par - параллельно), массив id - одним проходом,
+    //поэтому удаление k документов не стоит k сдвигов массива.
+    void RemoveDocuments(const std::vector<int>& document_ids);
+
+    void RemoveDocuments(std::execution::sequenced_policy, const std::vector<int>& document_ids);
+
+    void RemoveDocuments(std::execution::parallel_policy, const std::vector<int>& document_ids);
+
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
     
     template <class ExecutionPolicy>
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(ExecutionPolicy&& policy, std::string_view raw_query, int document_id) const;
 
 private:
+    //шардированному серверу нужны разбор запроса и поиск с глобальной статистикой
+    friend class ShardedSearchServer;
+    //загрузчик корпуса разбивает документы на слова в своих потоках
+    friend CorpusLoadStats LoadCorpus(SearchServer& search_server, const std::string& path,
+                                      const CorpusLoadOptions& options);
     
     struct DocumentData {
         int rating;
         DocumentStatus status;
-        std::map<std::string_view, double> frequency_of_words;
+        //пары (номер слова, частота), отсортированы по номеру слова
+        std::vector<std::pair<uint32_t, double>> term_freqs;
+        int word_count;
     };
     
     const std::set<std::string, std::less<>> stop_words_;
-    std::map<std::string, std::map<int, double>, std::less<>> word_to_document_freqs_;
+    const IndexOptions index_options_;
+    //номер слова из terms_ - индекс в postings_ и positions_ и значение в term_dictionary_
+    TermArena terms_;
+    std::vector<std::map<int, double>> postings_;
+    std::vector<std::map<int, std::vector<uint8_t>>> positions_;
+    //нужен только для * и ~: точный поиск слова идёт через хеш-таблицу terms_,
+    //поэтому дерево - дополнительная память поверх неё (около 30 байт на слово)
+    TermDictionary term_dictionary_;
     std::map<int, DocumentData> documents_;
     std::vector<int> document_ids_;
+    long long total_word_count_ = 0;
+    RelevanceScorer scorer_;
+    //счётчики для GetIndexStatistics
+    size_t posting_count_ = 0;
+    size_t empty_posting_lists_ = 0;
+    size_t position_list_bytes_ = 0;
+    //число списков документов по номеру старшего бита длины
+    std::array<size_t, 32> posting_length_histogram_{};
 
     bool IsStopWord(std::string_view word) const;
 
@@ -85,6 +156,21 @@ private:
 
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
+    uint32_t AddTerm(std::string_view word);
+
+    void EraseDocument(std::map<int, DocumentData>::const_iterator document_it);
+
+    template <class ExecutionPolicy>
+    void RemoveDocumentBatch(ExecutionPolicy&& policy, const std::vector<int>& document_ids);
+
+    void OnPostingListResized(size_t old_size, size_t new_size);
+
+    size_t ErasePositions(uint32_t term_id, int document_id);
+
+    const std::map<int, double>* FindPostings(std::string_view word) const;
+
+    bool ContainsWord(std::string_view word, int document_id) const;
+
     struct QueryWord {
         std::string_view data;
         bool is_minus;
@@ -93,25 +179,92 @@ private:
 
     QueryWord ParseQueryWord(std::string_view text) const;
 
+    void ExpandQueryWord(std::string_view word, std::vector<std::string_view>& words) const;
+
+    struct Phrase {
+        std::vector<std::string_view> words;
+        //смещения слов от начала фразы, стоп-слова тоже занимают позицию
+        std::vector<int> offsets;
+        int slop;
+    };
+
     struct Query {
         std::vector<std::string_view> plus_words;
         std::vector<std::string_view> minus_words;
+        std::vector<Phrase> phrases;
     };
 
+    void AddQueryWord(Query& query, const QueryWord& query_word) const;
+
+    Phrase ParsePhrase(std::string_view text, int slop) const;
+
     Query ParseQueryNoSort(std::string_view text) const;
     
     Query ParseQuery(std::string_view text) const;
 
-    double ComputeWordInverseDocumentFreq(const std::string& word) const;
+    //Разбиение документа на слова без стоп-слов. Не меняет индекс, поэтому
+    //может выполняться в других потоках параллельно с AddTokenizedDocument.
+    std::vector<std::string_view> TokenizeDocument(std::string_view document) const;
+
+    //words - результат TokenizeDocument(document): позиции слов берутся из разбиения document
+    void AddTokenizedDocument(int document_id, std::string_view document,
+                              const std::vector<std::string_view>& words,
+                              DocumentStatus status, const std::vector<int>& ratings);
+
+    void IndexPositions(int document_id, std::string_view document);
+
+    bool MatchPhrase(const Phrase& phrase, int document_id) const;
+
+    std::vector<int> FindPhraseDocuments(const std::vector<Phrase>& phrases) const;
+
+    double ComputeAverageDocumentLength() const;
+
+    struct CorpusStatistics {
+        int document_count;
+        double average_document_length;
+        //если слова здесь нет, берётся число документов со словом из этого индекса
+        std::map<std::string_view, int> document_freqs;
+    };
+
+    CorpusStatistics GetCorpusStatistics() const;
+
+    int GetDocumentFreq(std::string_view word) const;
+
+    template <class ExecutionPolicy>
+    static void SortAndTruncate(ExecutionPolicy&& policy, std::vector<Document>& documents);
+
+    //parallelism задаётся, когда политику выбрал вызывающий
+    QueryPlan BuildQueryPlan(const Query& query, const CorpusStatistics& statistics,
+                             std::optional<QueryParallelism> parallelism) const;
+
+    bool IsExcluded(const QueryPlan& plan, int document_id) const;
 
     template <class ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const Query& query,
+        DocumentPredicate document_predicate, const CorpusStatistics& statistics) const;
+
+    template <class ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const Query& query,
+        const QueryPlan& plan, DocumentPredicate document_predicate,
+        const CorpusStatistics& statistics) const;
+
+    template <class ExecutionPolicy, typename DocumentPredicate, typename Scorer>
     std::vector<Document> FindAllDocuments(ExecutionPolicy&& policy,
-        const Query& query, DocumentPredicate document_predicate) const;
+        const QueryPlan& plan, const std::vector<int>& phrase_documents,
+        DocumentPredicate document_predicate,
+        const Scorer& scorer, const CorpusStatistics& statistics) const;
+
+    template <typename DocumentPredicate, typename Scorer>
+    std::vector<Document> FindTopCandidates(
+        const QueryPlan& plan, const std::vector<int>& phrase_documents,
+        DocumentPredicate document_predicate,
+        const Scorer& scorer, const CorpusStatistics& statistics) const;
 };
 
 template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words)
-: stop_words_(MakeUniqueNonEmptyStrings(stop_words)) {
+SearchServer::SearchServer(const StringContainer& stop_words, IndexOptions options)
+: stop_words_(MakeUniqueNonEmptyStrings(stop_words))
+, index_options_(options) {
     if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
         using namespace std::string_literals;
         throw std::invalid_argument("Some of stop words are invalid"s);
@@ -121,29 +274,19 @@ SearchServer::SearchServer(const StringContainer& stop_words)
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(
         std::string_view raw_query, DocumentPredicate document_predicate) const {
-    return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+    const Query query = ParseQuery(raw_query);
+    const CorpusStatistics statistics = GetCorpusStatistics();
+    const QueryPlan plan = BuildQueryPlan(query, statistics, std::nullopt);
+    if (plan.parallelism == QueryParallelism::PARALLEL) {
+        return FindTopDocuments(std::execution::par, query, plan, document_predicate, statistics);
+    }
+    return FindTopDocuments(std::execution::seq, query, plan, document_predicate, statistics);
 }
 
 template <class ExecutionPolicy, typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy,
         std::string_view raw_query, DocumentPredicate document_predicate) const {
-    const auto query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
-    sort(
-        policy,
-        matched_documents.begin(), matched_documents.end(),
-        [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
-                return lhs.rating > rhs.rating;
-            } else {
-                return lhs.relevance > rhs.relevance;
-            }
-        }
-    );
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-       matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
-    return matched_documents;
+    return FindTopDocuments(policy, ParseQuery(raw_query), document_predicate, GetCorpusStatistics());
 }
     
 template <class ExecutionPolicy>
@@ -163,43 +306,91 @@ std::vector<Document> SearchServer::FindTopDocuments(
     return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
 }
 
+template <class ExecutionPolicy>
+void SearchServer::SortAndTruncate(ExecutionPolicy&& policy, std::vector<Document>& documents) {
+    sort(
+        policy,
+        documents.begin(), documents.end(),
+        [](const Document& lhs, const Document& rhs) {
+            if (std::abs(lhs.relevance - rhs.relevance) < RELEVANCE_EPSILON) {
+                return lhs.rating > rhs.rating;
+            } else {
+                return lhs.relevance > rhs.relevance;
+            }
+        }
+    );
+    if (documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
+       documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    }
+}
+
 template <class ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const Query& query,
+        DocumentPredicate document_predicate, const CorpusStatistics& statistics) const {
+    const QueryParallelism parallelism =
+        std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>
+            ? QueryParallelism::SEQUENTIAL
+            : QueryParallelism::PARALLEL;
+    return FindTopDocuments(policy, query, BuildQueryPlan(query, statistics, parallelism),
+                            document_predicate, statistics);
+}
+
+template <class ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const Query& query,
+        const QueryPlan& plan, DocumentPredicate document_predicate,
+        const CorpusStatistics& statistics) const {
+    if (plan.is_empty) {
+        return {};
+    }
+    //фразы проверяются до подсчёта релевантности, позиции читаются только у кандидатов
+    const std::vector<int> phrase_documents = query.phrases.empty()
+        ? std::vector<int>{}
+        : FindPhraseDocuments(query.phrases);
+    if (!query.phrases.empty() && phrase_documents.empty()) {
+        return {};
+    }
+    auto matched_documents = std::visit(
+        [&](const auto& scorer) {
+            if (plan.execution == QueryExecution::DOCUMENT_AT_A_TIME) {
+                return FindTopCandidates(plan, phrase_documents, document_predicate,
+                                         scorer, statistics);
+            }
+            return FindAllDocuments(policy, plan, phrase_documents, document_predicate,
+                                    scorer, statistics);
+        },
+        scorer_);
+    SortAndTruncate(policy, matched_documents);
+    return matched_documents;
+}
+
+template <class ExecutionPolicy, typename DocumentPredicate, typename Scorer>
 std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy&& policy,
-        const Query& query, DocumentPredicate document_predicate) const {
+        const QueryPlan& plan, const std::vector<int>& phrase_documents,
+        DocumentPredicate document_predicate,
+        const Scorer& scorer, const CorpusStatistics& statistics) const {
     ConcurrentMap<int, double> document_to_relevance(2000);
     for_each(
         policy,
-        query.plus_words.begin(), query.plus_words.end(),
-        [&](std::string_view word_view) {
-            std::string word(word_view);
-            if (word_to_document_freqs_.count(word) == 0) {
-                return;
-            }
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-            for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
+        plan.plus_terms.begin(), plan.plus_terms.end(),
+        [&](const PlannedTerm& term) {
+            for (const auto [document_id, term_freq] : postings_[term.term_id]) {
+                if (plan.phrase_count > 0 && !std::binary_search(
+                        phrase_documents.begin(), phrase_documents.end(), document_id)) {
+                    continue;
+                }
+                if (IsExcluded(plan, document_id)) {
+                    continue;
+                }
                 const auto& document_data = documents_.at(document_id);
                 if (document_predicate(document_id,
                         document_data.status, document_data.rating)) {
                     document_to_relevance[document_id].ref_to_value
-                        += term_freq * inverse_document_freq;
+                        += scorer.ComputeScore(term.weight, term_freq,
+                            document_data.word_count, statistics.average_document_length);
                 }
             }
         }
     );
-    for_each(
-        policy,
-        query.minus_words.begin(), query.minus_words.end(),
-        [&](std::string_view word_view) {
-            if (word_to_document_freqs_.count(word_view) == 0) {
-                return;
-            }
-            std::string word(word_view);
-            for (const auto [document_id, _] :
-                word_to_document_freqs_.at(word)) {
-                document_to_relevance.erase(document_id);
-            }
-        }
-    );
     std::vector<Document> matched_documents;
     for (const auto& [document_id, relevance] :
          document_to_relevance.BuildOrdinaryMap()) {
@@ -209,6 +400,92 @@ std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy&& policy,
     return matched_documents;
 }
 
+template <typename DocumentPredicate, typename Scorer>
+std::vector<Document> SearchServer::FindTopCandidates(
+        const QueryPlan& plan, const std::vector<int>& phrase_documents,
+        DocumentPredicate document_predicate,
+        const Scorer& scorer, const CorpusStatistics& statistics) const {
+    //MaxScore: слова идут по возрастанию верхней границы вклада. Если сумма границ первых
+    //слов меньше порога входа в топ, документ только с этими словами в топ не попадёт,
+    //поэтому их списки не обходятся, а документ ищется в них по id.
+    //Возвращаются все документы, которые были не хуже порога на момент проверки.
+    const std::vector<PlannedTerm>& terms = plan.plus_terms;
+    std::vector<double> bound_sums(terms.size() + 1, 0.0);
+    std::vector<std::map<int, double>::const_iterator> cursors;
+    cursors.reserve(terms.size());
+    for (size_t i = 0; i < terms.size(); ++i) {
+        bound_sums[i + 1] = bound_sums[i] + terms[i].upper_bound;
+        cursors.push_back(postings_[terms[i].term_id].begin());
+    }
+    std::priority_queue<double, std::vector<double>, std::greater<>> top_relevances;
+    double threshold = -std::numeric_limits<double>::infinity();
+    size_t first_essential = 0;
+    std::vector<std::pair<size_t, double>> matched_terms;
+    std::vector<Document> candidates;
+    while (true) {
+        int document_id = std::numeric_limits<int>::max();
+        bool has_document = false;
+        for (size_t i = first_essential; i < terms.size(); ++i) {
+            if (cursors[i] != postings_[terms[i].term_id].end()) {
+                document_id = std::min(document_id, cursors[i]->first);
+                has_document = true;
+            }
+        }
+        if (!has_document) {
+            break;
+        }
+        matched_terms.clear();
+        for (size_t i = first_essential; i < terms.size(); ++i) {
+            if (cursors[i] != postings_[terms[i].term_id].end() && cursors[i]->first == document_id) {
+                matched_terms.push_back({i, cursors[i]->second});
+                ++cursors[i];
+            }
+        }
+        if (plan.phrase_count > 0 && !std::binary_search(
+                phrase_documents.begin(), phrase_documents.end(), document_id)) {
+            continue;
+        }
+        if (IsExcluded(plan, document_id)) {
+            continue;
+        }
+        const auto& document_data = documents_.at(document_id);
+        if (!document_predicate(document_id, document_data.status, document_data.rating)) {
+            continue;
+        }
+        double relevance = 0.0;
+        for (const auto& [i, term_freq] : matched_terms) {
+            relevance += scorer.ComputeScore(terms[i].weight, term_freq,
+                document_data.word_count, statistics.average_document_length);
+        }
+        for (size_t i = first_essential; i-- > 0;) {
+            if (relevance + bound_sums[i + 1] < threshold - RELEVANCE_EPSILON) {
+                break;
+            }
+            const auto& postings = postings_[terms[i].term_id];
+            if (const auto it = postings.find(document_id); it != postings.end()) {
+                relevance += scorer.ComputeScore(terms[i].weight, it->second,
+                    document_data.word_count, statistics.average_document_length);
+            }
+        }
+        if (relevance < threshold - RELEVANCE_EPSILON) {
+            continue;
+        }
+        candidates.push_back({document_id, relevance, document_data.rating});
+        top_relevances.push(relevance);
+        if (top_relevances.size() > static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT)) {
+            top_relevances.pop();
+        }
+        if (top_relevances.size() == static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT)) {
+            threshold = top_relevances.top();
+            while (first_essential < terms.size()
+                   && bound_sums[first_essential + 1] < threshold - RELEVANCE_EPSILON) {
+                ++first_essential;
+            }
+        }
+    }
+    return candidates;
+}
+
 template <class ExecutionPolicy>
 std::tuple<std::vector<std::string_view>, DocumentStatus>
 SearchServer::MatchDocument(ExecutionPolicy&& policy,
@@ -231,18 +508,20 @@ SearchServer::MatchDocument(ExecutionPolicy&& policy,
     if (query.plus_words.empty() || any_of(
         query.minus_words.begin(), query.minus_words.end(),
         [this, document_id](std::string_view word_view) {
-            return word_to_document_freqs_.count(word_view) > 0 &&
-                   word_to_document_freqs_.find(word_view)->second.count(document_id);
+            return ContainsWord(word_view, document_id);
+        }) || !all_of(
+        query.phrases.begin(), query.phrases.end(),
+        [this, document_id](const Phrase& phrase) {
+            return MatchPhrase(phrase, document_id);
         })) {
-        return {{}, documents_.at(document_id).status};
+        return {std::vector<std::string_view>{}, documents_.at(document_id).status};
     }
     std::vector<std::string_view> matched_words = move(query.plus_words);
     matched_words.resize(remove_if(
         policy,
         matched_words.begin(), matched_words.end(),
         [this, document_id](std::string_view word_view) {
-            return !word_to_document_freqs_.count(word_view) ||
-                   !word_to_document_freqs_.find(word_view)->second.count(document_id);
+            return !ContainsWord(word_view, document_id);
         }
     ) - matched_words.begin());
     sort(matched_words.begin(), matched_words.end());
@@ -0,0 +1,242 @@
+#include "protocol.h"
+#include "../benchmarks/benchmark_data.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+//Нагрузка на query_server по loopback: несколько соединений, в каждом
+//до depth запросов FindTopDocuments в полёте. Печатает QPS и перцентили задержки.
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+struct Options {
+    uint16_t tcp_port = 5555;
+    string unix_path;
+    int connections = 4;
+    int depth = 16;
+    int requests_per_connection = 10'000;
+    int documents = 10'000;
+};
+
+int Connect(const Options& options) {
+    int fd;
+    if (!options.unix_path.empty()) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, options.unix_path.c_str(), sizeof(address.sun_path) - 1);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            throw runtime_error("connect: "s + strerror(errno));
+        }
+    } else {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(options.tcp_port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            throw runtime_error("connect: "s + strerror(errno));
+        }
+        const int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    }
+    return fd;
+}
+
+void SendAll(int fd, string_view data) {
+    while (!data.empty()) {
+        const ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent <= 0) {
+            throw runtime_error("send: "s + strerror(errno));
+        }
+        data.remove_prefix(sent);
+    }
+}
+
+//читает ответы, пока не наберётся хотя бы один целый кадр, и вызывает handler для каждого
+template <typename Handler>
+void ReceiveResponses(int fd, string& input, Handler handler) {
+    char buffer[64 * 1024];
+    while (true) {
+        string_view unread = input;
+        bool is_received = false;
+        while (const auto frame = ExtractFrame(unread)) {
+            ByteReader reader(*frame);
+            const uint32_t request_id = reader.ReadU32();
+            const auto code = static_cast<ResponseCode>(reader.ReadU8());
+            if (code == ResponseCode::ERROR) {
+                throw runtime_error("Server error: "s + string(reader.ReadString()));
+            }
+            handler(request_id);
+            is_received = true;
+        }
+        input.erase(0, input.size() - unread.size());
+        if (is_received) {
+            return;
+        }
+        const ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            throw runtime_error("Connection closed by server"s);
+        }
+        input.append(buffer, received);
+    }
+}
+
+//Документы отправляются окнами: в полёте не больше PRELOAD_WINDOW запросов, иначе
+//сервер перестанет читать, пока не отправит ответы, а клиент не дочитает их, застряв в send
+void LoadDocuments(const Options& options, const vector<string>& documents) {
+    const size_t PRELOAD_WINDOW = 1024;
+    const int fd = Connect(options);
+    string input;
+    string output;
+    size_t next_document = 0;
+    auto send_documents = [&](size_t count) {
+        output.clear();
+        for (size_t i = 0; i < count && next_document < documents.size(); ++i) {
+            Request request;
+            request.request_id = static_cast<uint32_t>(next_document);
+            request.type = RequestType::ADD_DOCUMENT;
+            request.document_id = static_cast<int>(next_document);
+            request.ratings = {1, 2, 3};
+            request.text = documents[next_document++];
+            WriteRequest(output, request);
+        }
+        SendAll(fd, output);
+    };
+    send_documents(PRELOAD_WINDOW);
+    size_t answered = 0;
+    while (answered < documents.size()) {
+        size_t newly_answered = 0;
+        ReceiveResponses(fd, input, [&newly_answered](uint32_t) {
+            ++newly_answered;
+        });
+        answered += newly_answered;
+        send_documents(newly_answered);
+    }
+    close(fd);
+}
+
+vector<double> RunConnection(const Options& options, const vector<string>& queries) {
+    const int fd = Connect(options);
+    vector<Clock::time_point> sent_at(options.requests_per_connection);
+    vector<double> latencies;
+    latencies.reserve(options.requests_per_connection);
+    string input;
+    string output;
+    int next_request = 0;
+    auto send_requests = [&](int count) {
+        output.clear();
+        for (int i = 0; i < count && next_request < options.requests_per_connection; ++i) {
+            Request request;
+            request.request_id = static_cast<uint32_t>(next_request);
+            request.text = queries[next_request % queries.size()];
+            WriteRequest(output, request);
+            sent_at[next_request++] = Clock::now();
+        }
+        SendAll(fd, output);
+    };
+    send_requests(options.depth);
+    while (static_cast<int>(latencies.size()) < options.requests_per_connection) {
+        int answered = 0;
+        ReceiveResponses(fd, input, [&](uint32_t request_id) {
+            const chrono::duration<double, micro> latency = Clock::now() - sent_at.at(request_id);
+            latencies.push_back(latency.count());
+            ++answered;
+        });
+        send_requests(answered);
+    }
+    close(fd);
+    return latencies;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const string_view arg = argv[i];
+        if (arg == "--tcp"sv && i + 1 < argc) {
+            options.tcp_port = static_cast<uint16_t>(stoi(argv[++i]));
+        } else if (arg == "--unix"sv && i + 1 < argc) {
+            options.unix_path = argv[++i];
+        } else if (arg == "--connections"sv && i + 1 < argc) {
+            options.connections = stoi(argv[++i]);
+        } else if (arg == "--depth"sv && i + 1 < argc) {
+            options.depth = stoi(argv[++i]);
+        } else if (arg == "--requests"sv && i + 1 < argc) {
+            options.requests_per_connection = stoi(argv[++i]);
+        } else if (arg == "--documents"sv && i + 1 < argc) {
+            options.documents = stoi(argv[++i]);
+        } else {
+            cerr << "Usage: "s << argv[0]
+                 << " [--tcp PORT | --unix PATH] [--connections N] [--depth N]"s
+                 << " [--requests N] [--documents N]"s << endl;
+            return 1;
+        }
+    }
+
+    try {
+        mt19937 generator;
+        const auto dictionary = GenerateDictionary(generator, 1000, 10);
+        const auto documents = GenerateQueries(generator, dictionary, options.documents, 70);
+        const auto queries = GenerateQueries(generator, dictionary, 1000, 10, 0.1);
+        if (!documents.empty()) {
+            LoadDocuments(options, documents);
+        }
+
+        vector<vector<double>> latencies(options.connections);
+        const auto start = Clock::now();
+        vector<thread> threads;
+        for (int i = 0; i < options.connections; ++i) {
+            threads.emplace_back([&, i] {
+                try {
+                    latencies[i] = RunConnection(options, queries);
+                } catch (const exception& e) {
+                    cerr << "Connection "s << i << ": "s << e.what() << endl;
+                }
+            });
+        }
+        for (thread& connection_thread : threads) {
+            connection_thread.join();
+        }
+        const chrono::duration<double> elapsed = Clock::now() - start;
+
+        vector<double> all_latencies;
+        for (const auto& connection_latencies : latencies) {
+            all_latencies.insert(all_latencies.end(), connection_latencies.begin(), connection_latencies.end());
+        }
+        if (all_latencies.empty()) {
+            return 1;
+        }
+        sort(all_latencies.begin(), all_latencies.end());
+        auto percentile = [&all_latencies](double p) {
+            return all_latencies[min(all_latencies.size() - 1,
+                                     static_cast<size_t>(p * all_latencies.size()))];
+        };
+        cout << "requests = "s << all_latencies.size()
+             << ", qps = "s << all_latencies.size() / elapsed.count() << endl;
+        cout << "latency us: p50 = "s << percentile(0.5)
+             << ", p90 = "s << percentile(0.9)
+             << ", p99 = "s << percentile(0.99)
+             << ", p99.9 = "s << percentile(0.999)
+             << ", max = "s << all_latencies.back() << endl;
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+}
@@ -0,0 +1,181 @@
+#include "protocol.h"
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+ByteWriter::ByteWriter(string& buffer)
+: buffer_(buffer) {
+}
+
+void ByteWriter::WriteU8(uint8_t value) {
+    buffer_.push_back(static_cast<char>(value));
+}
+
+void ByteWriter::WriteU32(uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        buffer_.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+void ByteWriter::WriteI32(int32_t value) {
+    WriteU32(static_cast<uint32_t>(value));
+}
+
+void ByteWriter::WriteDouble(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    WriteU32(static_cast<uint32_t>(bits));
+    WriteU32(static_cast<uint32_t>(bits >> 32));
+}
+
+void ByteWriter::WriteString(string_view value) {
+    WriteU32(static_cast<uint32_t>(value.size()));
+    buffer_.append(value);
+}
+
+size_t ByteWriter::BeginFrame() {
+    const size_t frame_start = buffer_.size();
+    WriteU32(0);
+    return frame_start;
+}
+
+void ByteWriter::EndFrame(size_t frame_start) {
+    const uint32_t length = static_cast<uint32_t>(buffer_.size() - frame_start - sizeof(uint32_t));
+    for (int i = 0; i < 4; ++i) {
+        buffer_[frame_start + i] = static_cast<char>((length >> (8 * i)) & 0xFF);
+    }
+}
+
+ByteReader::ByteReader(string_view data)
+: data_(data) {
+}
+
+uint8_t ByteReader::ReadU8() {
+    return static_cast<uint8_t>(ReadBytes(1)[0]);
+}
+
+uint32_t ByteReader::ReadU32() {
+    const string_view bytes = ReadBytes(4);
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(bytes[i])) << (8 * i);
+    }
+    return value;
+}
+
+int32_t ByteReader::ReadI32() {
+    return static_cast<int32_t>(ReadU32());
+}
+
+double ByteReader::ReadDouble() {
+    const uint64_t low = ReadU32();
+    const uint64_t high = ReadU32();
+    const uint64_t bits = low | (high << 32);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+string_view ByteReader::ReadString() {
+    return ReadBytes(ReadU32());
+}
+
+bool ByteReader::IsEmpty() const {
+    return data_.empty();
+}
+
+string_view ByteReader::ReadBytes(size_t size) {
+    if (data_.size() < size) {
+        throw out_of_range("Frame is truncated"s);
+    }
+    const string_view bytes = data_.substr(0, size);
+    data_.remove_prefix(size);
+    return bytes;
+}
+
+optional<string_view> ExtractFrame(string_view& data) {
+    if (data.size() < sizeof(uint32_t)) {
+        return nullopt;
+    }
+    const uint32_t length = ByteReader(data).ReadU32();
+    if (length > MAX_FRAME_SIZE) {
+        throw length_error("Frame is too large"s);
+    }
+    if (data.size() < sizeof(uint32_t) + length) {
+        return nullopt;
+    }
+    const string_view frame = data.substr(sizeof(uint32_t), length);
+    data.remove_prefix(sizeof(uint32_t) + length);
+    return frame;
+}
+
+Request ParseRequest(string_view frame) {
+    ByteReader reader(frame);
+    Request request;
+    request.request_id = reader.ReadU32();
+    request.type = static_cast<RequestType>(reader.ReadU8());
+    switch (request.type) {
+    case RequestType::FIND_TOP_DOCUMENTS:
+        request.status = static_cast<DocumentStatus>(reader.ReadU8());
+        request.text = reader.ReadString();
+        break;
+    case RequestType::MATCH_DOCUMENT:
+        request.document_id = reader.ReadI32();
+        request.text = reader.ReadString();
+        break;
+    case RequestType::ADD_DOCUMENT: {
+        request.document_id = reader.ReadI32();
+        request.status = static_cast<DocumentStatus>(reader.ReadU8());
+        const uint32_t rating_count = reader.ReadU32();
+        if (rating_count > frame.size() / sizeof(int32_t)) {
+            throw out_of_range("Frame is truncated"s);
+        }
+        request.ratings.reserve(rating_count);
+        for (uint32_t i = 0; i < rating_count; ++i) {
+            request.ratings.push_back(reader.ReadI32());
+        }
+        request.text = reader.ReadString();
+        break;
+    }
+    case RequestType::REMOVE_DOCUMENT:
+        request.document_id = reader.ReadI32();
+        break;
+    default:
+        throw invalid_argument("Unknown request type"s);
+    }
+    if (!reader.IsEmpty()) {
+        throw invalid_argument("Request frame has trailing bytes"s);
+    }
+    return request;
+}
+
+void WriteRequest(string& buffer, const Request& request) {
+    ByteWriter writer(buffer);
+    const size_t frame_start = writer.BeginFrame();
+    writer.WriteU32(request.request_id);
+    writer.WriteU8(static_cast<uint8_t>(request.type));
+    switch (request.type) {
+    case RequestType::FIND_TOP_DOCUMENTS:
+        writer.WriteU8(static_cast<uint8_t>(request.status));
+        writer.WriteString(request.text);
+        break;
+    case RequestType::MATCH_DOCUMENT:
+        writer.WriteI32(request.document_id);
+        writer.WriteString(request.text);
+        break;
+    case RequestType::ADD_DOCUMENT:
+        writer.WriteI32(request.document_id);
+        writer.WriteU8(static_cast<uint8_t>(request.status));
+        writer.WriteU32(static_cast<uint32_t>(request.ratings.size()));
+        for (const int rating : request.ratings) {
+            writer.WriteI32(rating);
+        }
+        writer.WriteString(request.text);
+        break;
+    case RequestType::REMOVE_DOCUMENT:
+        writer.WriteI32(request.document_id);
+        break;
+    }
+    writer.EndFrame(frame_start);
+}
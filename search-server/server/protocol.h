@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../document.h"
+
+//Бинарный протокол сервера запросов.
+//Кадр: uint32 длина остатка кадра, затем тело. Числа записываются в little-endian.
+//Тело запроса: uint32 request_id, uint8 тип, затем поля типа:
+//  FIND_TOP_DOCUMENTS - uint8 статус, строка запроса
+//  MATCH_DOCUMENT     - int32 id документа, строка запроса
+//  ADD_DOCUMENT       - int32 id, uint8 статус, uint32 число оценок, int32 оценки, строка текста
+//  REMOVE_DOCUMENT    - int32 id
+//Строка - uint32 длина и байты.
+//Тело ответа: uint32 request_id, uint8 код (OK/ERROR), затем:
+//  FIND_TOP_DOCUMENTS - uint32 число документов, для каждого int32 id, double релевантность, int32 рейтинг
+//  MATCH_DOCUMENT     - uint8 статус, uint32 число слов, строки слов
+//  ERROR              - строка с текстом ошибки
+//Клиент может отправлять запросы, не дожидаясь ответов; ответы приходят
+//с тем же request_id, но не обязательно в порядке отправки.
+
+const uint32_t MAX_FRAME_SIZE = 64 * 1024 * 1024;
+
+enum class RequestType : uint8_t {
+    FIND_TOP_DOCUMENTS = 1,
+    MATCH_DOCUMENT = 2,
+    ADD_DOCUMENT = 3,
+    REMOVE_DOCUMENT = 4,
+};
+
+enum class ResponseCode : uint8_t {
+    OK = 0,
+    ERROR = 1,
+};
+
+struct Request {
+    uint32_t request_id = 0;
+    RequestType type = RequestType::FIND_TOP_DOCUMENTS;
+    int document_id = 0;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+    //запрос или текст документа, указывает внутрь кадра
+    std::string_view text;
+};
+
+class ByteWriter {
+public:
+    explicit ByteWriter(std::string& buffer);
+
+    void WriteU8(uint8_t value);
+
+    void WriteU32(uint32_t value);
+
+    void WriteI32(int32_t value);
+
+    void WriteDouble(double value);
+
+    void WriteString(std::string_view value);
+
+    //резервирует место под длину кадра, EndFrame записывает её
+    size_t BeginFrame();
+
+    void EndFrame(size_t frame_start);
+
+private:
+    std::string& buffer_;
+};
+
+class ByteReader {
+public:
+    explicit ByteReader(std::string_view data);
+
+    uint8_t ReadU8();
+
+    uint32_t ReadU32();
+
+    int32_t ReadI32();
+
+    double ReadDouble();
+
+    std::string_view ReadString();
+
+    bool IsEmpty() const;
+
+private:
+    std::string_view data_;
+
+    std::string_view ReadBytes(size_t size);
+};
+
+//Если в начале data лежит целый кадр, возвращает его тело и убирает кадр из data.
+//Бросает length_error, если длина кадра больше MAX_FRAME_SIZE.
+std::optional<std::string_view> ExtractFrame(std::string_view& data);
+
+Request ParseRequest(std::string_view frame);
+
+void WriteRequest(std::string& buffer, const Request& request);
@@ -0,0 +1,560 @@
+#include "protocol.h"
+#include "../search_server.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <limits.h>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+
+using namespace std;
+
+//Сервер запросов: один поток с epoll принимает соединения и читает кадры,
+//запросы выполняются в пуле потоков, ответы отправляются через writev.
+//Протокол описан в protocol.h.
+
+namespace {
+
+const int MAX_EPOLL_EVENTS = 256;
+const size_t READ_CHUNK_SIZE = 64 * 1024;
+//за один вызов Read читается не больше стольких блоков: ограничения очереди ответов
+//проверяются между вызовами, а остальное epoll сообщит снова
+const int MAX_READ_CHUNKS = 4;
+const int MAX_FRAMES_PER_TASK = 32;
+//Пока у соединения столько неотправленных ответов или пачек в пуле, его запросы не читаются,
+//чтобы клиент, который не читает ответы, не копил их в памяти сервера.
+//Чтение возобновляется, когда очередь уменьшится вдвое.
+const size_t MAX_OUTPUT_BYTES = 4 * 1024 * 1024;
+const size_t MAX_PENDING_BATCHES = 64;
+
+void ThrowSystemError(const string& what) {
+    throw runtime_error(what + ": "s + strerror(errno));
+}
+
+void SetNonBlocking(int fd) {
+    const int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        ThrowSystemError("fcntl"s);
+    }
+}
+
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t thread_count) {
+        for (size_t i = 0; i < thread_count; ++i) {
+            threads_.emplace_back([this] {
+                Run();
+            });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard guard(mutex_);
+            stopped_ = true;
+        }
+        condition_.notify_all();
+        for (thread& worker : threads_) {
+            worker.join();
+        }
+    }
+
+    void Submit(function<void()> task) {
+        {
+            lock_guard guard(mutex_);
+            tasks_.push_back(move(task));
+        }
+        condition_.notify_one();
+    }
+
+private:
+    mutex mutex_;
+    condition_variable condition_;
+    deque<function<void()>> tasks_;
+    bool stopped_ = false;
+    vector<thread> threads_;
+
+    void Run() {
+        while (true) {
+            function<void()> task;
+            {
+                unique_lock lock(mutex_);
+                condition_.wait(lock, [this] {
+                    return stopped_ || !tasks_.empty();
+                });
+                if (tasks_.empty()) {
+                    return;
+                }
+                task = move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+struct Connection {
+    explicit Connection(int fd)
+        : fd(fd) {
+    }
+
+    int fd;
+    //поля ниже без мьютекса трогает только поток epoll
+    string input;
+    bool is_closed = false;
+    //клиент закрыл свою сторону: новых запросов не будет, но ответы на принятые ещё отправляются
+    bool is_read_closed = false;
+    //сокет закрыт с обеих сторон, epoll сообщает EPOLLHUP при каждом ожидании
+    bool is_hung_up = false;
+    //события, на которые соединение сейчас подписано в epoll
+    uint32_t events = EPOLLIN;
+    bool is_reading_paused = false;
+    //ответы, готовые к отправке, заполняются потоками пула
+    mutex output_mutex;
+    deque<string> output;
+    size_t output_offset = 0;
+    size_t output_bytes = 0;
+    //пачки запросов, отданные в пул и ещё не записавшие ответы в output
+    size_t pending_batches = 0;
+};
+
+class QueryServer {
+public:
+    QueryServer(SearchServer& search_server, size_t worker_count)
+        : search_server_(search_server)
+        , pool_(worker_count) {
+        epoll_fd_ = epoll_create1(0);
+        if (epoll_fd_ < 0) {
+            ThrowSystemError("epoll_create1"s);
+        }
+        event_fd_ = eventfd(0, EFD_NONBLOCK);
+        if (event_fd_ < 0) {
+            ThrowSystemError("eventfd"s);
+        }
+        AddToEpoll(event_fd_, EPOLLIN);
+    }
+
+    void ListenTcp(uint16_t port) {
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            ThrowSystemError("socket"s);
+        }
+        const int enable = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            ThrowSystemError("bind"s);
+        }
+        Listen(fd);
+    }
+
+    void ListenUnix(const string& path) {
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            ThrowSystemError("socket"s);
+        }
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw invalid_argument("Unix socket path is too long"s);
+        }
+        strcpy(address.sun_path, path.c_str());
+        unlink(path.c_str());
+        if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            ThrowSystemError("bind"s);
+        }
+        Listen(fd);
+    }
+
+    void Run() {
+        epoll_event events[MAX_EPOLL_EVENTS];
+        while (true) {
+            const int event_count = epoll_wait(epoll_fd_, events, MAX_EPOLL_EVENTS, -1);
+            if (event_count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                ThrowSystemError("epoll_wait"s);
+            }
+            for (int i = 0; i < event_count; ++i) {
+                const int fd = events[i].data.fd;
+                if (fd == event_fd_) {
+                    FlushReady();
+                } else if (find(listen_fds_.begin(), listen_fds_.end(), fd) != listen_fds_.end()) {
+                    Accept(fd);
+                } else if (const auto it = connections_.find(fd); it != connections_.end()) {
+                    const auto connection = it->second;
+                    if (events[i].events & EPOLLERR) {
+                        Close(connection);
+                        continue;
+                    }
+                    //после EPOLLHUP в сокете могут остаться непрочитанные запросы
+                    if (events[i].events & EPOLLHUP) {
+                        connection->is_hung_up = true;
+                    }
+                    if (events[i].events & (EPOLLIN | EPOLLHUP)) {
+                        Read(connection);
+                    }
+                    if (!connection->is_closed && (events[i].events & EPOLLOUT)) {
+                        Flush(connection);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    SearchServer& search_server_;
+    //поиск под shared-блокировкой, добавление и удаление - под эксклюзивной
+    shared_mutex index_mutex_;
+    ThreadPool pool_;
+    int epoll_fd_ = -1;
+    int event_fd_ = -1;
+    vector<int> listen_fds_;
+    unordered_map<int, shared_ptr<Connection>> connections_;
+    mutex ready_mutex_;
+    vector<shared_ptr<Connection>> ready_;
+    vector<char> read_buffer_ = vector<char>(READ_CHUNK_SIZE);
+
+    void AddToEpoll(int fd, uint32_t events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+            ThrowSystemError("epoll_ctl"s);
+        }
+    }
+
+    void Listen(int fd) {
+        SetNonBlocking(fd);
+        if (listen(fd, SOMAXCONN) < 0) {
+            ThrowSystemError("listen"s);
+        }
+        AddToEpoll(fd, EPOLLIN);
+        listen_fds_.push_back(fd);
+    }
+
+    void Accept(int listen_fd) {
+        while (true) {
+            const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK);
+            if (fd < 0) {
+                return;
+            }
+            const int enable = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+            AddToEpoll(fd, EPOLLIN);
+            connections_[fd] = make_shared<Connection>(fd);
+        }
+    }
+
+    void Close(const shared_ptr<Connection>& connection) {
+        if (connection->is_closed) {
+            return;
+        }
+        connection->is_closed = true;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, connection->fd, nullptr);
+        close(connection->fd);
+        connections_.erase(connection->fd);
+    }
+
+    //Когда клиент закрывает свою сторону, целые кадры, пришедшие вместе с концом потока,
+    //всё равно выполняются, а соединение закрывается после отправки всех ответов
+    void Read(const shared_ptr<Connection>& connection) {
+        bool is_end_of_stream = false;
+        int chunk_count = 0;
+        while (!connection->is_read_closed && chunk_count < MAX_READ_CHUNKS) {
+            const ssize_t received = recv(connection->fd, read_buffer_.data(), read_buffer_.size(), 0);
+            if (received > 0) {
+                connection->input.append(read_buffer_.data(), received);
+                ++chunk_count;
+                continue;
+            }
+            if (received == 0) {
+                is_end_of_stream = true;
+                break;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            Close(connection);
+            return;
+        }
+        Dispatch(connection);
+        if (connection->is_closed) {
+            return;
+        }
+        if (is_end_of_stream) {
+            //недописанный последний кадр уже не завершится
+            connection->is_read_closed = true;
+            connection->input.clear();
+        }
+        //пачки, отданные в пул, могли упереться в ограничение очереди ответов
+        Flush(connection);
+    }
+
+    //целые кадры из входного буфера уходят в пул пачками по MAX_FRAMES_PER_TASK
+    void Dispatch(const shared_ptr<Connection>& connection) {
+        string_view unread = connection->input;
+        size_t batch_start = 0;
+        int batch_frames = 0;
+        try {
+            while (ExtractFrame(unread)) {
+                if (++batch_frames == MAX_FRAMES_PER_TASK) {
+                    const size_t batch_end = connection->input.size() - unread.size();
+                    Submit(connection, connection->input.substr(batch_start, batch_end - batch_start));
+                    batch_start = batch_end;
+                    batch_frames = 0;
+                }
+            }
+        } catch (const length_error&) {
+            Close(connection);
+            return;
+        }
+        const size_t consumed = connection->input.size() - unread.size();
+        if (consumed > batch_start) {
+            Submit(connection, connection->input.substr(batch_start, consumed - batch_start));
+        }
+        connection->input.erase(0, consumed);
+    }
+
+    void Submit(const shared_ptr<Connection>& connection, string batch) {
+        {
+            lock_guard guard(connection->output_mutex);
+            ++connection->pending_batches;
+        }
+        pool_.Submit([this, connection, batch = move(batch)] {
+            string responses;
+            string_view frames = batch;
+            while (const auto frame = ExtractFrame(frames)) {
+                Respond(responses, *frame);
+            }
+            {
+                lock_guard guard(connection->output_mutex);
+                connection->output_bytes += responses.size();
+                connection->output.push_back(move(responses));
+                --connection->pending_batches;
+            }
+            {
+                lock_guard guard(ready_mutex_);
+                ready_.push_back(connection);
+            }
+            const uint64_t signal = 1;
+            [[maybe_unused]] const ssize_t written = write(event_fd_, &signal, sizeof(signal));
+        });
+    }
+
+    void Respond(string& responses, string_view frame) {
+        ByteWriter writer(responses);
+        size_t frame_start = writer.BeginFrame();
+        uint32_t request_id = 0;
+        try {
+            const Request request = ParseRequest(frame);
+            request_id = request.request_id;
+            writer.WriteU32(request_id);
+            writer.WriteU8(static_cast<uint8_t>(ResponseCode::OK));
+            switch (request.type) {
+            case RequestType::FIND_TOP_DOCUMENTS: {
+                shared_lock lock(index_mutex_);
+                const auto documents = search_server_.FindTopDocuments(request.text, request.status);
+                lock.unlock();
+                writer.WriteU32(static_cast<uint32_t>(documents.size()));
+                for (const Document& document : documents) {
+                    writer.WriteI32(document.id);
+                    writer.WriteDouble(document.relevance);
+                    writer.WriteI32(document.rating);
+                }
+                break;
+            }
+            case RequestType::MATCH_DOCUMENT: {
+                //слова указывают внутрь индекса, поэтому пишем их под блокировкой
+                shared_lock lock(index_mutex_);
+                const auto [words, status] = search_server_.MatchDocument(request.text, request.document_id);
+                writer.WriteU8(static_cast<uint8_t>(status));
+                writer.WriteU32(static_cast<uint32_t>(words.size()));
+                for (string_view word : words) {
+                    writer.WriteString(word);
+                }
+                break;
+            }
+            case RequestType::ADD_DOCUMENT: {
+                unique_lock lock(index_mutex_);
+                search_server_.AddDocument(request.document_id, request.text, request.status, request.ratings);
+                break;
+            }
+            case RequestType::REMOVE_DOCUMENT: {
+                unique_lock lock(index_mutex_);
+                search_server_.RemoveDocument(request.document_id);
+                break;
+            }
+            }
+        } catch (const exception& e) {
+            responses.resize(frame_start);
+            frame_start = writer.BeginFrame();
+            writer.WriteU32(request_id);
+            writer.WriteU8(static_cast<uint8_t>(ResponseCode::ERROR));
+            writer.WriteString(e.what());
+        }
+        writer.EndFrame(frame_start);
+    }
+
+    void FlushReady() {
+        uint64_t signal_count;
+        [[maybe_unused]] const ssize_t received = read(event_fd_, &signal_count, sizeof(signal_count));
+        vector<shared_ptr<Connection>> ready;
+        {
+            lock_guard guard(ready_mutex_);
+            ready.swap(ready_);
+        }
+        for (const auto& connection : ready) {
+            if (!connection->is_closed) {
+                Flush(connection);
+            }
+        }
+    }
+
+    void Flush(const shared_ptr<Connection>& connection) {
+        unique_lock lock(connection->output_mutex);
+        auto& output = connection->output;
+        while (!output.empty()) {
+            iovec buffers[IOV_MAX];
+            int buffer_count = 0;
+            for (auto it = output.begin(); it != output.end() && buffer_count < IOV_MAX; ++it) {
+                const size_t offset = buffer_count == 0 ? connection->output_offset : 0;
+                buffers[buffer_count].iov_base = it->data() + offset;
+                buffers[buffer_count].iov_len = it->size() - offset;
+                ++buffer_count;
+            }
+            ssize_t written = writev(connection->fd, buffers, buffer_count);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                lock.unlock();
+                Close(connection);
+                return;
+            }
+            connection->output_bytes -= written;
+            while (written > 0) {
+                const size_t left = output.front().size() - connection->output_offset;
+                if (static_cast<size_t>(written) < left) {
+                    connection->output_offset += written;
+                    break;
+                }
+                written -= left;
+                output.pop_front();
+                connection->output_offset = 0;
+            }
+        }
+        //если сокет переполнен, дописываем по EPOLLOUT
+        const bool is_waiting_write = !output.empty();
+        const bool has_pending_batches = connection->pending_batches > 0;
+        if (connection->output_bytes > MAX_OUTPUT_BYTES
+            || connection->pending_batches > MAX_PENDING_BATCHES) {
+            connection->is_reading_paused = true;
+        } else if (connection->output_bytes <= MAX_OUTPUT_BYTES / 2
+                   && connection->pending_batches <= MAX_PENDING_BATCHES / 2) {
+            connection->is_reading_paused = false;
+        }
+        lock.unlock();
+        if (connection->is_read_closed && !is_waiting_write && !has_pending_batches) {
+            Close(connection);
+            return;
+        }
+        if (connection->is_hung_up && connection->is_read_closed) {
+            //клиента уже нет: ответы некому дочитать, а непрерывный EPOLLHUP не даёт
+            //держать сокет в epoll до конца выполнения принятых запросов
+            if (is_waiting_write) {
+                Close(connection);
+            } else {
+                epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, connection->fd, nullptr);
+            }
+            return;
+        }
+        const bool is_reading = !connection->is_read_closed && !connection->is_reading_paused;
+        const uint32_t events = (is_reading ? uint32_t{EPOLLIN} : 0u)
+                                | (is_waiting_write ? uint32_t{EPOLLOUT} : 0u);
+        if (events != connection->events) {
+            connection->events = events;
+            epoll_event event{};
+            event.events = events;
+            event.data.fd = connection->fd;
+            epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection->fd, &event);
+        }
+    }
+};
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    uint16_t tcp_port = 0;
+    string unix_path;
+    size_t worker_count = max(1u, thread::hardware_concurrency());
+    string stop_words;
+    IndexOptions options = IndexOptions::FREQUENCIES;
+    for (int i = 1; i < argc; ++i) {
+        const string_view arg = argv[i];
+        if (arg == "--tcp"sv && i + 1 < argc) {
+            tcp_port = static_cast<uint16_t>(stoi(argv[++i]));
+        } else if (arg == "--unix"sv && i + 1 < argc) {
+            unix_path = argv[++i];
+        } else if (arg == "--workers"sv && i + 1 < argc) {
+            worker_count = stoul(argv[++i]);
+        } else if (arg == "--stop-words"sv && i + 1 < argc) {
+            stop_words = argv[++i];
+        } else if (arg == "--positions"sv) {
+            options = IndexOptions::POSITIONS;
+        } else {
+            cerr << "Usage: "s << argv[0]
+                 << " [--tcp PORT] [--unix PATH] [--workers N] [--stop-words \"WORDS\"] [--positions]"s << endl;
+            return 1;
+        }
+    }
+    if (tcp_port == 0 && unix_path.empty()) {
+        tcp_port = 5555;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    try {
+        SearchServer search_server(stop_words, options);
+        QueryServer server(search_server, worker_count);
+        if (tcp_port != 0) {
+            server.ListenTcp(tcp_port);
+            cerr << "Listening on 127.0.0.1:"s << tcp_port << endl;
+        }
+        if (!unix_path.empty()) {
+            server.ListenUnix(unix_path);
+            cerr << "Listening on "s << unix_path << endl;
+        }
+        server.Run();
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+}
@@ -0,0 +1,248 @@
+#include "sharded_search_server.h"
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+using namespace std;
+
+ShardWorker::ShardWorker(size_t cpu)
+: thread_([this] { Run(); }) {
+#ifdef __linux__
+    //закрепляем поток за ядром; если не получилось, поток просто работает без привязки
+    const size_t cpu_count = max(1u, thread::hardware_concurrency());
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu % cpu_count, &cpu_set);
+    pthread_setaffinity_np(thread_.native_handle(), sizeof(cpu_set), &cpu_set);
+#else
+    (void)cpu;
+#endif
+}
+
+ShardWorker::~ShardWorker() {
+    {
+        lock_guard guard(mutex_);
+        stopped_ = true;
+    }
+    condition_.notify_one();
+    thread_.join();
+}
+
+future<void> ShardWorker::Submit(function<void()> task) {
+    packaged_task<void()> packaged(move(task));
+    future<void> result = packaged.get_future();
+    {
+        lock_guard guard(mutex_);
+        tasks_.push_back(move(packaged));
+    }
+    condition_.notify_one();
+    return result;
+}
+
+void ShardWorker::Run() {
+    while (true) {
+        packaged_task<void()> task;
+        {
+            unique_lock lock(mutex_);
+            condition_.wait(lock, [this] {
+                return stopped_ || !tasks_.empty();
+            });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
+
+ShardedSearchServer::ShardedSearchServer(const std::string& stop_words_text, size_t shard_count,
+                                         IndexOptions options)
+: ShardedSearchServer(SplitIntoWords(stop_words_text), shard_count, options) {
+}
+
+ShardedSearchServer::ShardedSearchServer(string_view stop_words_text, size_t shard_count,
+                                         IndexOptions options)
+: ShardedSearchServer(SplitIntoWords(stop_words_text), shard_count, options) {
+}
+
+void ShardedSearchServer::AddDocument(int document_id, string_view document,
+                                      DocumentStatus status, const vector<int>& ratings) {
+    shards_[GetShardIndex(document_id)].AddDocument(document_id, document, status, ratings);
+    document_ids_.push_back(document_id);
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(
+    string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(
+        raw_query,
+        [status](int /*document_id*/, DocumentStatus document_status, int /*rating*/) {
+            return document_status == status;
+        });
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    int document_count = 0;
+    for (const SearchServer& shard : shards_) {
+        document_count += shard.GetDocumentCount();
+    }
+    return document_count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+void ShardedSearchServer::SetScorer(const RelevanceScorer& scorer) {
+    for (SearchServer& shard : shards_) {
+        shard.SetScorer(scorer);
+    }
+}
+
+vector<int>::iterator ShardedSearchServer::begin() {
+    return document_ids_.begin();
+}
+
+vector<int>::iterator ShardedSearchServer::end() {
+    return document_ids_.end();
+}
+
+map<string_view, double> ShardedSearchServer::GetWordFrequencies(int document_id) const {
+    return shards_[GetShardIndex(document_id)].GetWordFrequencies(document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    RemoveDocument(execution::seq, document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(execution::sequenced_policy, int document_id) {
+    auto it = find(document_ids_.begin(), document_ids_.end(), document_id);
+    if (it == document_ids_.end()) {
+        return;
+    }
+    shards_[GetShardIndex(document_id)].RemoveDocument(execution::seq, document_id);
+    document_ids_.erase(it);
+}
+
+void ShardedSearchServer::RemoveDocument(execution::parallel_policy, int document_id) {
+    auto it = find(document_ids_.begin(), document_ids_.end(), document_id);
+    if (it == document_ids_.end()) {
+        return;
+    }
+    shards_[GetShardIndex(document_id)].RemoveDocument(execution::par, document_id);
+    document_ids_.erase(it);
+}
+
+template <class ExecutionPolicy>
+void ShardedSearchServer::RemoveDocumentBatch(ExecutionPolicy&& policy, const vector<int>& document_ids) {
+    vector<vector<int>> shard_document_ids(shards_.size());
+    for (const int document_id : document_ids) {
+        shard_document_ids[GetShardIndex(document_id)].push_back(document_id);
+    }
+    ForEachShard([&](size_t shard) {
+        shards_[shard].RemoveDocuments(policy, shard_document_ids[shard]);
+    });
+    vector<int> removed_ids = document_ids;
+    sort(removed_ids.begin(), removed_ids.end());
+    document_ids_.erase(
+        remove_if(policy, document_ids_.begin(), document_ids_.end(),
+                  [&removed_ids](int document_id) {
+                      return binary_search(removed_ids.begin(), removed_ids.end(), document_id);
+                  }),
+        document_ids_.end());
+}
+
+void ShardedSearchServer::RemoveDocuments(const vector<int>& document_ids) {
+    RemoveDocuments(execution::seq, document_ids);
+}
+
+void ShardedSearchServer::RemoveDocuments(execution::sequenced_policy, const vector<int>& document_ids) {
+    RemoveDocumentBatch(execution::seq, document_ids);
+}
+
+void ShardedSearchServer::RemoveDocuments(execution::parallel_policy, const vector<int>& document_ids) {
+    RemoveDocumentBatch(execution::par, document_ids);
+}
+
+tuple<vector<string_view>, DocumentStatus>
+ShardedSearchServer::MatchDocument(string_view raw_query, int document_id) const {
+    return MatchDocument(execution::seq, raw_query, document_id);
+}
+
+void ShardedSearchServer::StartWorkers() {
+    workers_.reserve(shards_.size());
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        workers_.push_back(make_unique<ShardWorker>(i));
+    }
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+    //перемешиваем биты, чтобы идущие подряд id не попадали в шарды по кругу
+    const uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(document_id)) * 0x9E3779B97F4A7C15ull;
+    return (hash >> 32) % shards_.size();
+}
+
+void ShardedSearchServer::ForEachShard(const function<void(size_t)>& task) const {
+    vector<future<void>> results;
+    results.reserve(workers_.size());
+    for (size_t shard = 0; shard < workers_.size(); ++shard) {
+        results.push_back(workers_[shard]->Submit([&task, shard] {
+            task(shard);
+        }));
+    }
+    for (auto& result : results) {
+        result.wait();
+    }
+    for (auto& result : results) {
+        result.get();
+    }
+}
+
+ShardedSearchServer::ShardedQuery ShardedSearchServer::ParseQuery(string_view raw_query) const {
+    //каждый шард разбирает запрос сам: слова с * и ~ раскрываются по его словарю
+    ShardedQuery query{vector<SearchServer::Query>(shards_.size()), {GetDocumentCount(), 0.0, {}}};
+    vector<vector<pair<string_view, int>>> local_freqs(shards_.size());
+    ForEachShard([&](size_t shard) {
+        query.queries[shard] = shards_[shard].ParseQuery(raw_query);
+        local_freqs[shard].reserve(query.queries[shard].plus_words.size());
+        for (string_view word : query.queries[shard].plus_words) {
+            local_freqs[shard].push_back({word, shards_[shard].GetDocumentFreq(word)});
+        }
+    });
+
+    SearchServer::CorpusStatistics& statistics = query.statistics;
+    long long total_word_count = 0;
+    for (const SearchServer& shard : shards_) {
+        total_word_count += shard.total_word_count_;
+    }
+    if (statistics.document_count > 0) {
+        statistics.average_document_length = total_word_count * 1.0 / statistics.document_count;
+    }
+    for (const auto& shard_freqs : local_freqs) {
+        for (const auto& [word, document_freq] : shard_freqs) {
+            statistics.document_freqs[word] += document_freq;
+        }
+    }
+    return query;
+}
+
+vector<Document> ShardedSearchServer::FindTopInShards(
+        const function<vector<Document>(size_t)>& find_in_shard) const {
+    vector<vector<Document>> shard_documents(shards_.size());
+    ForEachShard([&](size_t shard) {
+        shard_documents[shard] = find_in_shard(shard);
+    });
+
+    vector<Document> matched_documents;
+    matched_documents.reserve(shards_.size() * MAX_RESULT_DOCUMENT_COUNT);
+    for (const auto& documents : shard_documents) {
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+    }
+    SearchServer::SortAndTruncate(execution::seq, matched_documents);
+    return matched_documents;
+}
@@ -0,0 +1,194 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "search_server.h"
+
+//Поток, закреплённый за одним шардом. Задачи выполняются по очереди.
+class ShardWorker {
+public:
+    explicit ShardWorker(size_t cpu);
+
+    ShardWorker(const ShardWorker&) = delete;
+
+    ShardWorker& operator=(const ShardWorker&) = delete;
+
+    ~ShardWorker();
+
+    std::future<void> Submit(std::function<void()> task);
+
+private:
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::deque<std::packaged_task<void()>> tasks_;
+    bool stopped_ = false;
+    std::thread thread_;
+
+    void Run();
+};
+
+//Документы распределяются по шардам по хешу id. Запрос рассылается всем шардам,
+//IDF и средняя длина документа считаются по всем шардам сразу, поэтому
+//релевантность совпадает с релевантностью одного SearchServer.
+class ShardedSearchServer {
+public:
+    template <typename StringContainer>
+    ShardedSearchServer(const StringContainer& stop_words, size_t shard_count,
+                        IndexOptions options = IndexOptions::FREQUENCIES);
+
+    ShardedSearchServer(const std::string& stop_words_text, size_t shard_count,
+                        IndexOptions options = IndexOptions::FREQUENCIES);
+
+    ShardedSearchServer(std::string_view stop_words_text, size_t shard_count,
+                        IndexOptions options = IndexOptions::FREQUENCIES);
+
+    void AddDocument(int document_id, std::string_view document,
+                     DocumentStatus status, const std::vector<int>& ratings);
+
+    //Без явной политики каждый шард выбирает план запроса сам, как SearchServer
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(
+        std::string_view raw_query, DocumentPredicate document_predicate) const;
+
+    template <class ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy,
+        std::string_view raw_query, DocumentPredicate document_predicate) const;
+
+    std::vector<Document> FindTopDocuments(
+        std::string_view raw_query, DocumentStatus status) const;
+
+    template <class ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy,
+        std::string_view raw_query, DocumentStatus status) const;
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    template <class ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(
+        ExecutionPolicy&& policy, std::string_view raw_query) const;
+
+    int GetDocumentCount() const;
+
+    size_t GetShardCount() const;
+
+    void SetScorer(const RelevanceScorer& scorer);
+
+    std::vector<int>::iterator begin();
+
+    std::vector<int>::iterator end();
+
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+
+    void RemoveDocument(int document_id);
+
+    void RemoveDocument(std::execution::sequenced_policy, int document_id);
+
+    void RemoveDocument(std::execution::parallel_policy, int document_id);
+
+    //Шарды удаляют свои документы одновременно, policy передаётся в каждый шард
+    void RemoveDocuments(const std::vector<int>& document_ids);
+
+    void RemoveDocuments(std::execution::sequenced_policy, const std::vector<int>& document_ids);
+
+    void RemoveDocuments(std::execution::parallel_policy, const std::vector<int>& document_ids);
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+
+    template <class ExecutionPolicy>
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(ExecutionPolicy&& policy, std::string_view raw_query, int document_id) const;
+
+private:
+    //запрос, разобранный каждым шардом, и статистика корпуса по всем шардам
+    struct ShardedQuery {
+        std::vector<SearchServer::Query> queries;
+        SearchServer::CorpusStatistics statistics;
+    };
+
+    //deque: SearchServer не копируется, а шарды не должны перемещаться
+    std::deque<SearchServer> shards_;
+    std::vector<std::unique_ptr<ShardWorker>> workers_;
+    std::vector<int> document_ids_;
+
+    void StartWorkers();
+
+    size_t GetShardIndex(int document_id) const;
+
+    void ForEachShard(const std::function<void(size_t)>& task) const;
+
+    ShardedQuery ParseQuery(std::string_view raw_query) const;
+
+    //собирает топ каждого шарда и оставляет общий топ
+    std::vector<Document> FindTopInShards(
+        const std::function<std::vector<Document>(size_t)>& find_in_shard) const;
+
+    template <class ExecutionPolicy>
+    void RemoveDocumentBatch(ExecutionPolicy&& policy, const std::vector<int>& document_ids);
+};
+
+template <typename StringContainer>
+ShardedSearchServer::ShardedSearchServer(const StringContainer& stop_words, size_t shard_count,
+                                         IndexOptions options) {
+    if (shard_count == 0) {
+        using namespace std::string_literals;
+        throw std::invalid_argument("Shard count must be positive"s);
+    }
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.emplace_back(stop_words, options);
+    }
+    StartWorkers();
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(
+        std::string_view raw_query, DocumentPredicate document_predicate) const {
+    const ShardedQuery query = ParseQuery(raw_query);
+    return FindTopInShards([&](size_t shard) {
+        //длины списков у шардов разные, поэтому и планы могут различаться
+        const SearchServer& server = shards_[shard];
+        const QueryPlan plan = server.BuildQueryPlan(query.queries[shard], query.statistics, std::nullopt);
+        if (plan.parallelism == QueryParallelism::PARALLEL) {
+            return server.FindTopDocuments(std::execution::par, query.queries[shard], plan,
+                                           document_predicate, query.statistics);
+        }
+        return server.FindTopDocuments(std::execution::seq, query.queries[shard], plan,
+                                       document_predicate, query.statistics);
+    });
+}
+
+template <class ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(ExecutionPolicy&& policy,
+        std::string_view raw_query, DocumentPredicate document_predicate) const {
+    const ShardedQuery query = ParseQuery(raw_query);
+    return FindTopInShards([&](size_t shard) {
+        return shards_[shard].FindTopDocuments(
+            policy, query.queries[shard], document_predicate, query.statistics);
+    });
+}
+
+template <class ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(ExecutionPolicy&& policy,
+        std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(
+        policy,
+        raw_query,
+        [status](int /*document_id*/, DocumentStatus document_status, int /*rating*/) {
+            return document_status == status;
+        });
+}
+
+template <class ExecutionPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(
+        ExecutionPolicy&& policy, std::string_view raw_query) const {
+    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <class ExecutionPolicy>
+std::tuple<std::vector<std::string_view>, DocumentStatus>
+ShardedSearchServer::MatchDocument(ExecutionPolicy&& policy,
+                                   std::string_view raw_query, int document_id) const {
+    return shards_[GetShardIndex(document_id)].MatchDocument(policy, raw_query, document_id);
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+//Ограниченная очередь для одного писателя и одного читателя.
+//Push ждёт, пока в очереди не освободится место, Pop - пока не появится элемент,
+//так медленная стадия конвейера притормаживает быструю.
+//Ждущая стадия недолго крутится, а потом засыпает на условной переменной,
+//чтобы не занимать ядро, пока соседняя стадия работает.
+//После Close ожидание прерывается: Push возвращает false, Pop - nullopt.
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity)
+    : slots_(capacity + 1) {
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    bool Push(T value) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t next_tail = Next(tail);
+        if (!Wait([&] {
+                return next_tail != head_.load(std::memory_order_acquire);
+            })) {
+            return false;
+        }
+        slots_[tail] = std::move(value);
+        tail_.store(next_tail, std::memory_order_release);
+        WakeWaiters();
+        return true;
+    }
+
+    std::optional<T> Pop() {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (!Wait([&] {
+                return head != tail_.load(std::memory_order_acquire);
+            })) {
+            return std::nullopt;
+        }
+        std::optional<T> value = std::move(slots_[head]);
+        head_.store(Next(head), std::memory_order_release);
+        WakeWaiters();
+        return value;
+    }
+
+    //Может вызываться из любого потока
+    void Close() {
+        is_closed_.store(true, std::memory_order_release);
+        std::lock_guard lock(mutex_);
+        is_changed_.notify_all();
+    }
+
+private:
+    static constexpr int SPIN_COUNT = 64;
+
+    std::vector<T> slots_;
+    //писатель и читатель меняют разные индексы, разносим их по разным кэш-линиям
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+    alignas(64) std::atomic<int> waiter_count_{0};
+    std::atomic<bool> is_closed_{false};
+    std::mutex mutex_;
+    std::condition_variable is_changed_;
+
+    size_t Next(size_t index) const {
+        return index + 1 == slots_.size() ? 0 : index + 1;
+    }
+
+    //false, если очередь закрыли
+    template <typename Predicate>
+    bool Wait(Predicate is_ready) {
+        for (int i = 0; i < SPIN_COUNT; ++i) {
+            if (IsClosed()) {
+                return false;
+            }
+            if (is_ready()) {
+                return true;
+            }
+            std::this_thread::yield();
+        }
+        //счётчик увеличивается до проверки под мьютексом: другая стадия либо увидит его
+        //и разбудит, либо успеет сдвинуть индекс раньше проверки. Забор в паре с забором
+        //в WakeWaiters не даёт обеим сторонам прочитать старые значения
+        waiter_count_.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        {
+            std::unique_lock lock(mutex_);
+            is_changed_.wait(lock, [&] {
+                return IsClosed() || is_ready();
+            });
+        }
+        waiter_count_.fetch_sub(1, std::memory_order_relaxed);
+        return !IsClosed();
+    }
+
+    bool IsClosed() const {
+        return is_closed_.load(std::memory_order_acquire);
+    }
+
+    void WakeWaiters() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiter_count_.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard lock(mutex_);
+            is_changed_.notify_all();
+        }
+    }
+};
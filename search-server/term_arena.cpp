@@ -0,0 +1,65 @@
+#include "term_arena.h"
+#include <cstring>
+
+using namespace std;
+
+uint32_t TermArena::Intern(string_view term) {
+    if (const auto it = term_ids_.find(term); it != term_ids_.end()) {
+        return it->second;
+    }
+    const uint32_t term_id = static_cast<uint32_t>(terms_.size());
+    const string_view stored = Store(term);
+    terms_.push_back(stored);
+    term_ids_.emplace(stored, term_id);
+    return term_id;
+}
+
+uint32_t TermArena::Find(string_view term) const {
+    const auto it = term_ids_.find(term);
+    return it == term_ids_.end() ? NO_TERM : it->second;
+}
+
+string_view TermArena::GetTerm(uint32_t term_id) const {
+    return terms_[term_id];
+}
+
+size_t TermArena::GetTermCount() const {
+    return terms_.size();
+}
+
+size_t TermArena::GetReservedBytes() const {
+    return reserved_bytes_;
+}
+
+size_t TermArena::GetUsedBytes() const {
+    return used_bytes_;
+}
+
+size_t TermArena::GetIndexBytes() const {
+    //узел хеш-таблицы: указатель на следующий, пара и сохранённый хеш
+    const size_t node_bytes = sizeof(void*) + sizeof(decltype(term_ids_)::value_type) + sizeof(size_t);
+    return terms_.capacity() * sizeof(string_view)
+           + term_ids_.bucket_count() * sizeof(void*)
+           + term_ids_.size() * node_bytes;
+}
+
+string_view TermArena::Store(string_view term) {
+    used_bytes_ += term.size();
+    if (term.size() > BLOCK_SIZE / 4) {
+        //длинное слово получает свой блок, чтобы не тратить остаток текущего
+        blocks_.push_back(make_unique<char[]>(term.size()));
+        reserved_bytes_ += term.size();
+        memcpy(blocks_.back().get(), term.data(), term.size());
+        return {blocks_.back().get(), term.size()};
+    }
+    if (current_block_ == nullptr || current_block_used_ + term.size() > BLOCK_SIZE) {
+        blocks_.push_back(make_unique<char[]>(BLOCK_SIZE));
+        reserved_bytes_ += BLOCK_SIZE;
+        current_block_ = blocks_.back().get();
+        current_block_used_ = 0;
+    }
+    char* data = current_block_ + current_block_used_;
+    memcpy(data, term.data(), term.size());
+    current_block_used_ += term.size();
+    return {data, term.size()};
+}
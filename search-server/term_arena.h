@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+//Хранилище слов индекса. Символы слов лежат подряд в больших блоках,
+//которые никогда не перемещаются, поэтому string_view на слово остаётся
+//верным всё время жизни хранилища. Каждому слову выдаётся 32-битный номер,
+//по string_view номер ищется в хеш-таблице без создания std::string.
+class TermArena {
+public:
+    static constexpr uint32_t NO_TERM = UINT32_MAX;
+
+    //возвращает номер слова, при необходимости добавляя его
+    uint32_t Intern(std::string_view term);
+
+    uint32_t Find(std::string_view term) const;
+
+    std::string_view GetTerm(uint32_t term_id) const;
+
+    size_t GetTermCount() const;
+
+    //байты, занятые блоками с символами, и байты, реально занятые словами
+    size_t GetReservedBytes() const;
+
+    size_t GetUsedBytes() const;
+
+    //байты массива string_view и хеш-таблицы номеров слов
+    size_t GetIndexBytes() const;
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* current_block_ = nullptr;
+    size_t current_block_used_ = 0;
+    size_t reserved_bytes_ = 0;
+    size_t used_bytes_ = 0;
+    std::vector<std::string_view> terms_;
+    std::unordered_map<std::string_view, uint32_t> term_ids_;
+
+    std::string_view Store(std::string_view term);
+};
@@ -0,0 +1,202 @@
+#include "term_dictionary.h"
+#include <algorithm>
+
+using namespace std;
+
+TermDictionary::TermDictionary()
+: nodes_{Node{nullptr, 0, NO_NODE, NO_NODE, NO_TERM}} {
+}
+
+void TermDictionary::Insert(string_view term, uint32_t term_id) {
+    uint32_t node = 0;
+    string_view rest = term;
+    while (!rest.empty()) {
+        uint32_t previous = NO_NODE;
+        uint32_t child = nodes_[node].first_child;
+        while (child != NO_NODE
+               && static_cast<unsigned char>(nodes_[child].label[0]) < static_cast<unsigned char>(rest[0])) {
+            previous = child;
+            child = nodes_[child].next_sibling;
+        }
+        const auto link = [&](uint32_t new_node) {
+            if (previous == NO_NODE) {
+                nodes_[node].first_child = new_node;
+            } else {
+                nodes_[previous].next_sibling = new_node;
+            }
+        };
+        if (child == NO_NODE || nodes_[child].label[0] != rest[0]) {
+            const uint32_t leaf = static_cast<uint32_t>(nodes_.size());
+            nodes_.push_back(Node{rest.data(), static_cast<uint32_t>(rest.size()), NO_NODE, child, term_id});
+            link(leaf);
+            return;
+        }
+        const string_view label = GetLabel(child);
+        const size_t common = mismatch(label.begin(), label.end(), rest.begin(), rest.end()).first - label.begin();
+        if (common < label.size()) {
+            //метка расходится со словом посередине: общее начало уходит в новый узел
+            const uint32_t middle = static_cast<uint32_t>(nodes_.size());
+            nodes_.push_back(Node{label.data(), static_cast<uint32_t>(common), child,
+                                  nodes_[child].next_sibling, NO_TERM});
+            nodes_[child].label += common;
+            nodes_[child].label_size -= static_cast<uint32_t>(common);
+            nodes_[child].next_sibling = NO_NODE;
+            link(middle);
+            child = middle;
+        }
+        node = child;
+        rest.remove_prefix(common);
+    }
+    nodes_[node].term_id = term_id;
+}
+
+vector<uint32_t> TermDictionary::FindByPrefix(string_view prefix) const {
+    vector<uint32_t> result;
+    uint32_t node = 0;
+    string_view rest = prefix;
+    while (!rest.empty()) {
+        node = FindChild(node, rest[0]);
+        if (node == NO_NODE) {
+            return result;
+        }
+        const string_view label = GetLabel(node);
+        const size_t compared = min(label.size(), rest.size());
+        if (label.substr(0, compared) != rest.substr(0, compared)) {
+            return result;
+        }
+        rest.remove_prefix(compared);
+    }
+    //префикс кончился внутри метки node или на её конце: подходит всё поддерево node
+    if (nodes_[node].term_id != NO_TERM) {
+        result.push_back(nodes_[node].term_id);
+    }
+    CollectTerms(node, result);
+    return result;
+}
+
+vector<uint32_t> TermDictionary::FindWithinDistance(string_view term, int max_distance) const {
+    //обход дерева эквивалентен пересечению с автоматом Левенштейна:
+    //для каждого символа пути держим строку матрицы расстояний до префиксов term
+    //и не спускаемся ниже, если минимум в строке превысил max_distance.
+    //Клетки дальше max_distance от диагонали всегда больше max_distance,
+    //поэтому строка глубины depth хранится только для префиксов длиной
+    //от depth - max_distance до depth + max_distance.
+    const int64_t term_size = static_cast<int64_t>(term.size());
+    const int64_t distance = max_distance;
+    const int64_t too_far = distance + 1;
+    //строки текущего пути подряд: строка глубины d начинается в row_begins[d],
+    //её первая клетка - префикс длины row_lows[d]
+    vector<int64_t> rows;
+    vector<size_t> row_begins;
+    vector<int64_t> row_lows;
+    const auto get_cell = [&](size_t depth, int64_t i) {
+        const int64_t offset = i - row_lows[depth];
+        const size_t row_end = depth + 1 < row_begins.size() ? row_begins[depth + 1] : rows.size();
+        if (offset < 0 || row_begins[depth] + offset >= row_end) {
+            return too_far;
+        }
+        return rows[row_begins[depth] + offset];
+    };
+
+    vector<uint32_t> result;
+    row_begins.push_back(0);
+    row_lows.push_back(0);
+    for (int64_t i = 0; i <= min(term_size, distance); ++i) {
+        rows.push_back(i);
+    }
+    if (term_size <= distance && nodes_[0].term_id != NO_TERM) {
+        result.push_back(nodes_[0].term_id);
+    }
+    //пары (узел, глубина перед его меткой); глубина дерева равна длине слова,
+    //поэтому обход без рекурсии
+    vector<pair<uint32_t, size_t>> pending;
+    if (nodes_[0].first_child != NO_NODE) {
+        pending.push_back({nodes_[0].first_child, 0});
+    }
+    while (!pending.empty()) {
+        const auto [node, start_depth] = pending.back();
+        pending.pop_back();
+        if (nodes_[node].next_sibling != NO_NODE) {
+            pending.push_back({nodes_[node].next_sibling, start_depth});
+        }
+        if (row_begins.size() > start_depth + 1) {
+            rows.resize(row_begins[start_depth + 1]);
+            row_begins.resize(start_depth + 1);
+            row_lows.resize(start_depth + 1);
+        }
+
+        const string_view label = GetLabel(node);
+        bool is_reachable = true;
+        for (size_t j = 0; j < label.size() && is_reachable; ++j) {
+            const size_t depth = start_depth + j + 1;
+            const int64_t low = max<int64_t>(0, static_cast<int64_t>(depth) - distance);
+            const int64_t high = min(term_size, static_cast<int64_t>(depth) + distance);
+            row_begins.push_back(rows.size());
+            row_lows.push_back(low);
+            int64_t row_min = too_far;
+            for (int64_t i = low; i <= high; ++i) {
+                int64_t cell = i == 0 ? static_cast<int64_t>(depth) : min({
+                    get_cell(depth - 1, i) + 1,
+                    (i > low ? rows.back() : too_far) + 1,
+                    get_cell(depth - 1, i - 1) + (term[i - 1] == label[j] ? 0 : 1)});
+                cell = min(cell, too_far);
+                rows.push_back(cell);
+                row_min = min(row_min, cell);
+            }
+            is_reachable = row_min <= distance;
+        }
+        if (!is_reachable) {
+            continue;
+        }
+        const size_t end_depth = start_depth + label.size();
+        if (nodes_[node].term_id != NO_TERM && get_cell(end_depth, term_size) <= distance) {
+            result.push_back(nodes_[node].term_id);
+        }
+        if (nodes_[node].first_child != NO_NODE) {
+            pending.push_back({nodes_[node].first_child, end_depth});
+        }
+    }
+    return result;
+}
+
+size_t TermDictionary::GetMemoryBytes() const {
+    return nodes_.capacity() * sizeof(Node);
+}
+
+string_view TermDictionary::GetLabel(uint32_t node) const {
+    return {nodes_[node].label, nodes_[node].label_size};
+}
+
+uint32_t TermDictionary::FindChild(uint32_t node, char first_char) const {
+    for (uint32_t child = nodes_[node].first_child; child != NO_NODE;
+         child = nodes_[child].next_sibling) {
+        if (nodes_[child].label[0] == first_char) {
+            return child;
+        }
+        if (static_cast<unsigned char>(nodes_[child].label[0]) > static_cast<unsigned char>(first_char)) {
+            break;
+        }
+    }
+    return NO_NODE;
+}
+
+void TermDictionary::CollectTerms(uint32_t node, vector<uint32_t>& result) const {
+    //глубина дерева равна длине самого длинного слова, поэтому обход без рекурсии
+    vector<uint32_t> pending;
+    if (nodes_[node].first_child != NO_NODE) {
+        pending.push_back(nodes_[node].first_child);
+    }
+    while (!pending.empty()) {
+        const uint32_t child = pending.back();
+        pending.pop_back();
+        if (nodes_[child].next_sibling != NO_NODE) {
+            pending.push_back(nodes_[child].next_sibling);
+        }
+        if (nodes_[child].term_id != NO_TERM) {
+            result.push_back(nodes_[child].term_id);
+        }
+        if (nodes_[child].first_child != NO_NODE) {
+            pending.push_back(nodes_[child].first_child);
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+//Сжатое префиксное дерево словаря для раскрытия prefix* и word~N.
+//Узлы лежат в плоском массиве: у каждого узла первый ребёнок и следующий брат
+//(братья отсортированы по первому символу метки). Цепочки узлов с одним ребёнком
+//сжаты в одну метку, и метка не копируется, а указывает в само добавленное слово,
+//поэтому слова должны жить дольше словаря (их хранит TermArena).
+//Значение узла - номер слова, если на этом узле заканчивается слово.
+//Удаление слов не поддерживается: слова из индекса не удаляются.
+class TermDictionary {
+public:
+    static constexpr uint32_t NO_TERM = UINT32_MAX;
+
+    TermDictionary();
+
+    void Insert(std::string_view term, uint32_t term_id);
+
+    std::vector<uint32_t> FindByPrefix(std::string_view prefix) const;
+
+    std::vector<uint32_t> FindWithinDistance(std::string_view term, int max_distance) const;
+
+    size_t GetMemoryBytes() const;
+
+private:
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+    struct Node {
+        const char* label;
+        uint32_t label_size;
+        uint32_t first_child;
+        uint32_t next_sibling;
+        uint32_t term_id;
+    };
+
+    std::vector<Node> nodes_;
+
+    std::string_view GetLabel(uint32_t node) const;
+
+    uint32_t FindChild(uint32_t node, char first_char) const;
+
+    void CollectTerms(uint32_t node, std::vector<uint32_t>& result) const;
+};